@@ -1,6 +1,13 @@
 TEMPLATE        =   subdirs
 
 SUBDIRS         =   src \
-                    tests
+                    tests \
+                    loadgen \
+                    benchmarks
+
+fuzz:SUBDIRS    +=  fuzz
 
 tests.depends   =   src
+loadgen.depends =   src
+benchmarks.depends = src
+fuzz.depends    =   src
@@ -0,0 +1,427 @@
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+#ifndef QT_NO_SSL
+# include <QSslCertificate>
+# include <QSslConfiguration>
+#endif
+
+#include <cstdlib>
+
+#include "../src/MXJsonPointer.hpp"
+#include "../src/MXRequestManager.hpp"
+#include "../src/MXSessionCache.hpp"
+
+// Allocation counting
+// Qt containers allocate through malloc()/realloc(), not operator new, so the
+// C allocator is interposed (glibc only). realloc() counts as an allocation.
+static QAtomicInteger<quint64>  g_allocations;
+
+#ifdef __GLIBC__
+# define MX_COUNT_ALLOCATIONS
+
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_calloc(std::size_t count, std::size_t size);
+extern "C" void *__libc_realloc(void *ptr, std::size_t size);
+
+extern "C" void *malloc(std::size_t size) noexcept
+{
+    g_allocations.fetchAndAddRelaxed(1);
+    return (__libc_malloc(size));
+}
+
+extern "C" void *calloc(std::size_t count, std::size_t size) noexcept
+{
+    g_allocations.fetchAndAddRelaxed(1);
+    return (__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *ptr, std::size_t size) noexcept
+{
+    g_allocations.fetchAndAddRelaxed(1);
+    return (__libc_realloc(ptr, size));
+}
+#endif
+// ---
+
+class MXRequestManagerBench : public QObject
+{
+    Q_OBJECT
+    private:
+        static QByteArray   flatDocument(int size);
+        static QByteArray   deepDocument(int depth);
+        static QByteArray   wideDocument(int keys);
+        static void         addRows(void);
+        static void         addSerializeRows(void);
+        static void         addPointerRows(void);
+        static bool         startTlsServer(QTemporaryDir const& dir, QProcess& server,
+                                           quint16 *port);
+
+    private Q_SLOTS:
+        void parseThroughput_data();
+        void parseThroughput();
+        void parseAllocations_data();
+        void parseAllocations();
+        void serializeManual_data();
+        void serializeManual();
+        void serializeDirect_data();
+        void serializeDirect();
+        void pointerLookup_data();
+        void pointerLookup();
+        void pointerFullParse_data();
+        void pointerFullParse();
+        void progressDelivery_data();
+        void progressDelivery();
+        void tlsHandshake_data();
+        void tlsHandshake();
+};
+
+// Payloads
+QByteArray MXRequestManagerBench::flatDocument(int size)
+{
+    QByteArray  doc("{\"items\":[");
+    int         i = 0;
+
+    doc.reserve(size + 128);
+    while (doc.size() < size - 80)
+    {
+        if (i > 0)
+            doc.append(',');
+        doc.append("{\"id\":").append(QByteArray::number(i++))
+           .append(",\"name\":\"item\",\"flag\":true,\"score\":1.5}");
+    }
+    doc.append("]}");
+    return (doc);
+}
+
+QByteArray MXRequestManagerBench::deepDocument(int depth)
+{
+    QByteArray  doc;
+    int         i = -1;
+
+    while (++i < depth)
+        doc.append("{\"a\":");
+    doc.append("1");
+    i = -1;
+    while (++i < depth)
+        doc.append('}');
+    return (doc);
+}
+
+QByteArray MXRequestManagerBench::wideDocument(int keys)
+{
+    QByteArray  doc("{");
+    int         i = -1;
+
+    while (++i < keys)
+    {
+        if (i > 0)
+            doc.append(',');
+        doc.append("\"key").append(QByteArray::number(i)).append("\":")
+           .append(QByteArray::number(i));
+    }
+    doc.append('}');
+    return (doc);
+}
+
+void MXRequestManagerBench::addRows(void)
+{
+    QTest::addColumn<QString>("contentType");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<bool>("valid");
+
+    QTest::newRow("flat 100B") << "application/json" << flatDocument(100) << true;
+    QTest::newRow("flat 10KB") << "application/json" << flatDocument(10 * 1024) << true;
+    QTest::newRow("flat 1MB") << "application/json" << flatDocument(1024 * 1024) << true;
+    QTest::newRow("flat 100MB") << "application/json" << flatDocument(100 * 1024 * 1024) << true;
+    QTest::newRow("deep 1000") << "application/json" << deepDocument(1000) << true;
+    QTest::newRow("wide 100k keys") << "application/json" << wideDocument(100000) << true;
+    QTest::newRow("malformed 1MB") << "application/json"
+                                   << flatDocument(1024 * 1024).left(512 * 1024) << false;
+    QTest::newRow("too deep") << "application/json" << deepDocument(5000) << false;
+    QTest::newRow("charset param") << "application/json; charset=utf-8"
+                                   << flatDocument(10 * 1024) << true;
+    QTest::newRow("uppercase type") << "APPLICATION/JSON" << flatDocument(10 * 1024) << true;
+    QTest::newRow("suffixed type") << "application/jsonp" << flatDocument(10 * 1024) << true;
+    QTest::newRow("wrong type") << "text/html" << flatDocument(10 * 1024) << false;
+}
+// ---
+
+// Benchmarks
+void MXRequestManagerBench::parseThroughput_data()
+{
+    addRows();
+}
+
+void MXRequestManagerBench::parseThroughput()
+{
+    QFETCH(QString, contentType);
+    QFETCH(QByteArray, body);
+    QFETCH(bool, valid);
+
+    MXRequestManager    req;
+    QElapsedTimer       timer;
+    int                 iterations = qMax(1, (256 * 1024 * 1024) / qMax(1, body.size()));
+    int                 i = -1;
+
+    iterations = qMin(iterations, 100000);
+    QCOMPARE(req.parseResponse(contentType, body), valid);
+
+    timer.start();
+    while (++i < iterations)
+        req.parseResponse(contentType, body);
+    QTest::setBenchmarkResult(double(body.size()) * iterations
+                              / (double(qMax(Q_INT64_C(1), timer.nsecsElapsed())) / 1e9),
+                              QTest::BytesPerSecond);
+}
+
+void MXRequestManagerBench::parseAllocations_data()
+{
+    addRows();
+}
+
+void MXRequestManagerBench::parseAllocations()
+{
+    QFETCH(QString, contentType);
+    QFETCH(QByteArray, body);
+
+    MXRequestManager    req;
+    quint64             before;
+
+#ifndef MX_COUNT_ALLOCATIONS
+    QSKIP("Allocations are only counted with glibc");
+#endif
+    req.parseResponse(contentType, body); // Warm up
+    before = g_allocations.load();
+    req.parseResponse(contentType, body);
+    QTest::setBenchmarkResult(double(g_allocations.load() - before), QTest::Events);
+}
+
+void MXRequestManagerBench::addSerializeRows(void)
+{
+    QTest::addColumn<QJsonObject>("body");
+
+    QTest::newRow("small") << QJsonDocument::fromJson(flatDocument(200)).object();
+    QTest::newRow("10KB") << QJsonDocument::fromJson(flatDocument(10 * 1024)).object();
+    QTest::newRow("1MB") << QJsonDocument::fromJson(flatDocument(1024 * 1024)).object();
+}
+
+void MXRequestManagerBench::serializeManual_data()
+{
+    addSerializeRows();
+}
+
+void MXRequestManagerBench::serializeDirect_data()
+{
+    addSerializeRows();
+}
+
+/**
+ * What callers did before the QJsonObject overload: go through QVariantMap
+ * and serialize it in the compact format, so only the conversion differs.
+ */
+void MXRequestManagerBench::serializeManual()
+{
+    QFETCH(QJsonObject, body);
+
+    QVariantMap map = body.toVariantMap();
+
+    QBENCHMARK {
+        QByteArray  data = QJsonDocument::fromVariant(map).toJson(QJsonDocument::Compact);
+        Q_UNUSED(data);
+    }
+}
+
+void MXRequestManagerBench::serializeDirect()
+{
+    QFETCH(QJsonObject, body);
+
+    QBENCHMARK {
+        QByteArray  data = MXRequestManager::toJsonBody(body);
+        Q_UNUSED(data);
+    }
+}
+
+void MXRequestManagerBench::addPointerRows(void)
+{
+    QByteArray  doc = flatDocument(10 * 1024 * 1024);
+    QByteArray  last = QByteArray::number(doc.count("\"id\"") - 1);
+
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<QString>("pointer");
+
+    QTest::newRow("10MB first") << doc << "/items/0/name";
+    QTest::newRow("10MB last") << doc << QString("/items/" + last + "/name");
+    QTest::newRow("10MB missing") << doc << "/status";
+}
+
+void MXRequestManagerBench::pointerLookup_data()
+{
+    addPointerRows();
+}
+
+void MXRequestManagerBench::pointerLookup()
+{
+    QFETCH(QByteArray, body);
+    QFETCH(QString, pointer);
+
+    MXJsonPointer   jsonPointer(pointer);
+
+    QBENCHMARK {
+        QVariant    value = jsonPointer.value(body);
+        Q_UNUSED(value);
+    }
+}
+
+void MXRequestManagerBench::pointerFullParse_data()
+{
+    addPointerRows();
+}
+
+/**
+ * Reference for pointerLookup: what data() costs for the same field.
+ */
+void MXRequestManagerBench::pointerFullParse()
+{
+    QFETCH(QByteArray, body);
+
+    MXRequestManager    req;
+
+    QBENCHMARK {
+        req.parseResponse("application/json", body);
+    }
+}
+
+void MXRequestManagerBench::progressDelivery_data()
+{
+    QTest::addColumn<int>("interval");
+
+    QTest::newRow("every chunk") << 0;
+    QTest::newRow("100ms") << 100;
+}
+
+/**
+ * A 1 GiB download in 16 KiB chunks, as seen by the progress slot.
+ */
+void MXRequestManagerBench::progressDelivery()
+{
+    QFETCH(int, interval);
+
+    MXRequestManager    req;
+    qint64              total = Q_INT64_C(1) << 30;
+    qint64              chunk = 16 * 1024;
+    qint64              received;
+
+    req.setProgressInterval(interval);
+    QBENCHMARK {
+        for (received = chunk; received <= total; received += chunk)
+            req.requestDownloadProgress(received, total);
+    }
+}
+
+/**
+ * Local TLS stand-in: "openssl s_server -www" with a throwaway certificate.
+ */
+bool MXRequestManagerBench::startTlsServer(QTemporaryDir const& dir, QProcess& server,
+                                           quint16 *port)
+{
+    QTcpServer  probe;
+    QTcpSocket  socket;
+    int         tries = 50;
+
+    if (!dir.isValid() || QProcess::execute("openssl", QStringList()
+            << "req" << "-x509" << "-newkey" << "rsa:2048" << "-nodes" << "-days" << "1"
+            << "-subj" << "/CN=localhost" << "-addext" << "subjectAltName=DNS:localhost"
+            << "-keyout" << dir.filePath("key.pem") << "-out" << dir.filePath("cert.pem")) != 0)
+        return (false);
+
+    if (!probe.listen(QHostAddress::LocalHost))
+        return (false);
+    *port = probe.serverPort();
+    probe.close();
+
+    server.start("openssl", QStringList() << "s_server" << "-quiet" << "-www"
+                 << "-accept" << QString::number(*port)
+                 << "-cert" << dir.filePath("cert.pem") << "-key" << dir.filePath("key.pem"));
+    if (!server.waitForStarted())
+        return (false);
+    while (tries-- > 0)
+    {
+        socket.connectToHost(QHostAddress::LocalHost, *port);
+        if (socket.waitForConnected(100))
+            return (true);
+        socket.abort();
+        QTest::qWait(100);
+    }
+    return (false);
+}
+
+void MXRequestManagerBench::tlsHandshake_data()
+{
+    QTest::addColumn<bool>("resume");
+
+    QTest::newRow("full handshake") << false;
+    QTest::newRow("resumed") << true;
+}
+
+/**
+ * A fresh manager per request, like a short-lived process: without the
+ * session cache, every request pays a full TLS handshake.
+ */
+void MXRequestManagerBench::tlsHandshake()
+{
+#ifdef QT_NO_SSL
+    QSKIP("Built without SSL support");
+#else
+    QFETCH(bool, resume);
+
+    QTemporaryDir       dir;
+    QProcess            server;
+    quint16             port;
+    QSslConfiguration   previous(QSslConfiguration::defaultConfiguration());
+    QSslConfiguration   configuration(previous);
+
+    if (!startTlsServer(dir, server, &port))
+        QSKIP("openssl can't run a local TLS server");
+    configuration.setCaCertificates(QSslCertificate::fromPath(dir.filePath("cert.pem")));
+    QSslConfiguration::setDefaultConfiguration(configuration);
+
+    int                 handshakes = 0;
+    int                 reused = 0;
+
+    MXSessionCache::clear();
+    MXSessionCache::resetStats();
+    MXSessionCache::setEnabled(resume);
+    QBENCHMARK {
+        MXRequestManager    req(QUrl("https://localhost:" + QString::number(port)));
+        QEventLoop          eventLoop;
+
+        connect(&req, SIGNAL(finished(bool)), &eventLoop, SLOT(quit()));
+        req.request("/", "GET");
+        eventLoop.exec();
+
+        // s_server -www tells whether the session was resumed
+        ++handshakes;
+        if (req.rawData().contains("\nReused, "))
+            ++reused;
+    }
+    qDebug("Tickets stored: %llu, offered: %llu, sessions reused: %d/%d",
+           MXSessionCache::stats().stores, MXSessionCache::stats().hits, reused, handshakes);
+
+    MXSessionCache::setEnabled(true);
+    QSslConfiguration::setDefaultConfiguration(previous);
+    server.kill();
+    server.waitForFinished();
+#endif
+}
+// ---
+
+QTEST_GUILESS_MAIN(MXRequestManagerBench)
+
+#include "bench_MXRequestManager.moc"
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Benchmarks of MXRequestManager (QtTest, -tickcounter/-callgrind welcome)
+#
+#-------------------------------------------------
+
+QT          +=  testlib network
+QT          -=  gui
+
+TARGET      =   bench_MXRequestManager
+CONFIG      +=  console
+CONFIG      -=  app_bundle
+
+TEMPLATE    =   app
+LIBS        +=  -L$$shadowed(../src) -lMXRequestManager2
+
+SOURCES     +=  bench_MXRequestManager.cpp
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# libFuzzer target for MXRequestManager::parseResponse()
+# Requires clang: qmake -spec linux-clang CONFIG+=fuzz
+# Run: ./fuzz_parseResponse corpus/
+#
+#-------------------------------------------------
+
+QT          +=  network
+QT          -=  gui
+
+TARGET      =   fuzz_parseResponse
+CONFIG      +=  console
+CONFIG      -=  app_bundle
+
+TEMPLATE    =   app
+LIBS        +=  -L$$shadowed(../src) -lMXRequestManager2
+
+QMAKE_CXXFLAGS  +=  -fsanitize=fuzzer,address,undefined
+QMAKE_LFLAGS    +=  -fsanitize=fuzzer,address,undefined
+
+SOURCES     +=  fuzz_parseResponse.cpp
@@ -0,0 +1,27 @@
+#include <QCoreApplication>
+
+#include <cstdint>
+
+#include "../src/MXRequestManager.hpp"
+
+/**
+ * Input layout: "<Content-Type>\n<body>". Without a newline the whole input
+ * is used as body, with "application/json" as Content-Type.
+ */
+extern "C" int  LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static int                  argc = 1;
+    static char                 name[] = "fuzz_parseResponse";
+    static char                 *argv[] = { name, NULL };
+    static QCoreApplication     app(argc, argv);
+    static MXRequestManager     req;
+
+    QByteArray  input(QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(size)));
+    int         newline = input.indexOf('\n');
+
+    if (newline < 0)
+        req.parseResponse("application/json", input);
+    else
+        req.parseResponse(QString::fromLatin1(input.left(newline)), input.mid(newline + 1));
+    return (0);
+}
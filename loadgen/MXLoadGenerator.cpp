@@ -0,0 +1,208 @@
+/**
+ * @file		MXLoadGenerator.cpp
+ * @brief		MXLoadGenerator
+ *
+ * @details		Drives an MXRequestManager at a target rate or concurrency
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QMetaEnum>
+
+#include "MXLoadGenerator.hpp"
+
+// Constructors
+MXLoadGenerator::MXLoadGenerator(MXRequestManager *manager, QObject *parent)
+    : QObject(parent), m_qps(0), m_concurrency(-1), m_durationMs(10000), m_maxRequests(0),
+      m_started(0), m_completed(0), m_succeeded(0), m_bytesReceived(0), m_next(0),
+      m_manager(manager)
+{
+    this->m_ticker.setTimerType(Qt::PreciseTimer);
+    connect(&this->m_ticker, SIGNAL(timeout()), SLOT(tick()));
+}
+// ---
+
+// Setters
+void	MXLoadGenerator::setMix(QList<MXRequestRecord> const& mix)
+{
+    this->m_mix = mix;
+}
+
+void	MXLoadGenerator::setQps(double qps)
+{
+    this->m_qps = qps;
+}
+
+void	MXLoadGenerator::setConcurrency(int concurrency)
+{
+    this->m_concurrency = concurrency;
+}
+
+void	MXLoadGenerator::setLimits(qint64 durationMs, qint64 maxRequests)
+{
+    this->m_durationMs = durationMs;
+    this->m_maxRequests = maxRequests;
+}
+
+qint64	MXLoadGenerator::started(void) const
+{
+    return (this->m_started);
+}
+
+MXLatencyHistogram const&	MXLoadGenerator::latencies(void) const
+{
+    return (this->m_latencies);
+}
+// ---
+
+// Treatments
+qint64	MXLoadGenerator::scheduledAt(qint64 index, double qps)
+{
+    return (qint64(double(index) * 1e9 / qps));
+}
+
+qint64	MXLoadGenerator::dueBy(qint64 elapsedMs, double qps)
+{
+    return (qint64(double(elapsedMs) * qps / 1000.0) + 1);
+}
+
+bool	MXLoadGenerator::isDone(void) const
+{
+    return ((this->m_durationMs > 0 && this->m_clock.elapsed() >= this->m_durationMs)
+            || (this->m_maxRequests > 0 && this->m_started >= this->m_maxRequests));
+}
+
+void	MXLoadGenerator::sendOne(qint64 scheduledNs)
+{
+    MXRequestRecord const&	record = this->m_mix.at(this->m_next);
+    QString					resource = record.url.path();
+    Watcher					*watcher = new Watcher(this);
+    int						i = -1;
+
+    this->m_next = (this->m_next + 1) % this->m_mix.size();
+    if (record.url.hasQuery())
+        resource.append('?').append(record.url.query(QUrl::FullyEncoded));
+
+    while (++i < record.requestHeaders.size())
+        if (record.requestHeaders.at(i).first.toLower() != "content-length")
+            this->m_manager->setRequestHeader(record.requestHeaders.at(i).first,
+                                              record.requestHeaders.at(i).second);
+
+    connect(watcher, SIGNAL(finished()), SLOT(replyFinished()));
+    ++this->m_started;
+    this->m_inFlight.insert(watcher, scheduledNs);
+    watcher->setFuture(this->m_manager->requestAsync(resource, record.method,
+                                                     record.requestBody));
+}
+
+void	MXLoadGenerator::start(void)
+{
+    int	i = -1;
+
+    if (this->m_mix.isEmpty())
+    {
+        emit this->finished();
+        return;
+    }
+
+    this->m_clock.start();
+    if (this->m_qps > 0)
+        this->m_ticker.start(qMax(1, int(1000.0 / this->m_qps)));
+    else
+        while (++i < qMax(1, this->m_concurrency))
+            this->sendOne(this->m_clock.nsecsElapsed());
+}
+
+void	MXLoadGenerator::tick(void)
+{
+    qint64	due;
+
+    if (this->isDone())
+    {
+        this->m_ticker.stop();
+        if (this->m_inFlight.isEmpty())
+            emit this->finished();
+        return;
+    }
+
+    // Late requests keep their slot: the wait counts in their latency
+    due = dueBy(this->m_clock.elapsed(), this->m_qps);
+    while (this->m_started < due && !this->isDone()
+           && (this->m_concurrency <= 0 || this->m_inFlight.size() < this->m_concurrency))
+        this->sendOne(scheduledAt(this->m_started, this->m_qps));
+}
+
+void	MXLoadGenerator::replyFinished(void)
+{
+    Watcher							*watcher = static_cast<Watcher*>(this->sender());
+    MXRequestManager::Response		response = watcher->result();
+    qint64							startedAt = this->m_inFlight.take(watcher);
+
+    this->m_latencies.record(quint64(this->m_clock.nsecsElapsed() - startedAt) / 1000);
+    ++this->m_completed;
+    this->m_bytesReceived += response.rawData.size();
+    if (response.error != QNetworkReply::NoError)
+        ++this->m_networkErrors[response.error];
+    if (response.httpCode != 0)
+        ++this->m_httpCodes[response.httpCode];
+    if (response.error == QNetworkReply::NoError && response.httpCode < 400)
+        ++this->m_succeeded;
+    watcher->deleteLater();
+
+    if (this->m_qps <= 0 && !this->isDone())
+        this->sendOne(this->m_clock.nsecsElapsed());
+    else if (this->m_inFlight.isEmpty() && this->isDone())
+    {
+        this->m_ticker.stop();
+        emit this->finished();
+    }
+}
+
+void	MXLoadGenerator::report(QTextStream& out) const
+{
+    QMetaEnum	errors = QNetworkReply::staticMetaObject.enumerator(
+                             QNetworkReply::staticMetaObject.indexOfEnumerator("NetworkError"));
+    double		seconds = qMax(0.001, double(this->m_clock.elapsed()) / 1000.0);
+    double		percentiles[] = { 50, 75, 90, 99, 99.9, 99.99 };
+    unsigned	i = 0;
+
+    out << "Requests:     " << this->m_completed << " completed, "
+        << this->m_succeeded << " succeeded, "
+        << (this->m_completed - this->m_succeeded) << " failed" << '\n';
+    out << "Duration:     " << QString::number(seconds, 'f', 3) << " s" << '\n';
+    out << "Throughput:   " << QString::number(double(this->m_completed) / seconds, 'f', 1)
+        << " req/s, "
+        << QString::number(double(this->m_bytesReceived) / seconds / 1024.0, 'f', 1)
+        << " KiB/s" << '\n';
+
+    out << "HTTP codes:" << '\n';
+    for (QMap<int, qint64>::const_iterator it = this->m_httpCodes.constBegin();
+         it != this->m_httpCodes.constEnd(); ++it)
+        out << "  " << it.key() << ": " << it.value() << '\n';
+
+    out << "Network errors:" << '\n';
+    for (QMap<int, qint64>::const_iterator it = this->m_networkErrors.constBegin();
+         it != this->m_networkErrors.constEnd(); ++it)
+        out << "  " << errors.valueToKey(it.key()) << " (" << it.key() << "): "
+            << it.value() << '\n';
+
+    out << "Latency (ms): min " << QString::number(this->m_latencies.min() / 1000.0, 'f', 3)
+        << ", mean " << QString::number(this->m_latencies.mean() / 1000.0, 'f', 3)
+        << ", max " << QString::number(this->m_latencies.max() / 1000.0, 'f', 3) << '\n';
+    for (i = 0; i < sizeof(percentiles) / sizeof(*percentiles); ++i)
+        out << "  p" << percentiles[i] << ": "
+            << QString::number(this->m_latencies.percentile(percentiles[i]) / 1000.0, 'f', 3)
+            << '\n';
+}
+// ---
@@ -0,0 +1,156 @@
+/**
+ * @brief		MXLoadGenerator
+ *
+ * @details		Drives an MXRequestManager at a target rate or concurrency
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXLOADGENERATOR_HPP
+# define	MXLOADGENERATOR_HPP
+
+# include	<QElapsedTimer>
+# include	<QFutureWatcher>
+# include	<QHash>
+# include	<QList>
+# include	<QMap>
+# include	<QObject>
+# include	<QTextStream>
+# include	<QTimer>
+
+# include	"../src/MXLatencyHistogram.hpp"
+# include	"../src/MXRequestManager.hpp"
+# include	"../src/MXRequestRecorder.hpp"
+
+/**
+ * @class	MXLoadGenerator
+ * @brief	Sends requests through an MXRequestManager and measures them
+ * @extends	QObject
+ *
+ * Two modes are available:
+ * - open loop: requests are started at a fixed rate (qps), whatever the latency,
+ * - closed loop: a fixed number of requests are kept in flight (concurrency).
+ * In open loop mode, latencies are measured from the time each request was
+ * scheduled, not sent, so a backed up server isn't hidden by the generator
+ * waiting for it (coordinated omission).
+ * Requests are taken in turn from the request mix (a single URL or a capture
+ * written by MXRequestRecorder).
+ */
+
+class MXLoadGenerator : public QObject
+{
+    Q_OBJECT
+
+    private:
+        typedef QFutureWatcher<MXRequestManager::Response>	Watcher;
+
+        double						m_qps;
+        int							m_concurrency;
+        qint64						m_durationMs;
+        qint64						m_maxRequests;
+        qint64						m_started;
+        qint64						m_completed;
+        qint64						m_succeeded;
+        qint64						m_bytesReceived;
+        int							m_next;
+        MXRequestManager			*m_manager;
+        QList<MXRequestRecord>		m_mix;
+        QElapsedTimer				m_clock;
+        QTimer						m_ticker;
+        QHash<Watcher*, qint64>		m_inFlight;		// Scheduled start time in ns
+        QMap<int, qint64>			m_networkErrors;
+        QMap<int, qint64>			m_httpCodes;
+        MXLatencyHistogram			m_latencies;	// In microseconds
+
+        bool	isDone(void) const;
+        void	sendOne(qint64 scheduledNs);
+
+    public:
+        /**
+         * Constructs a generator sending through the given manager (not owned).
+         */
+        MXLoadGenerator(MXRequestManager *manager, QObject *parent = 0);
+
+        /**
+         * Set the request mix, sent in a round-robin fashion.
+         */
+        void	setMix(QList<MXRequestRecord> const& mix);
+
+        /**
+         * Set the open loop rate. 0 switches to closed loop mode.
+         */
+        void	setQps(double qps);
+
+        /**
+         * Set the number of requests in flight in closed loop mode (default 1),
+         * or the maximum in flight in open loop mode (default 0 = unbounded).
+         */
+        void	setConcurrency(int concurrency);
+
+        /**
+         * Set the stop conditions. 0 disables a condition.
+         */
+        void	setLimits(qint64 durationMs, qint64 maxRequests);
+
+        /**
+         * Get the number of requests started
+         */
+        qint64	started(void) const;
+
+        /**
+         * Get the latencies measured so far, in microseconds
+         */
+        MXLatencyHistogram const&	latencies(void) const;
+
+        /**
+         * Prints the throughput, error breakdown and latency percentiles.
+         */
+        void	report(QTextStream& out) const;
+
+        /**
+         * Get the time an open loop request is scheduled at.
+         *
+         * @param[in]	index	Request number, from 0
+         * @param[in]	qps		Rate
+         * @return		qint64	Time since the start, in ns
+         */
+        static qint64	scheduledAt(qint64 index, double qps);
+
+        /**
+         * Get the number of open loop requests scheduled so far.
+         *
+         * @param[in]	elapsedMs	Time since the start
+         * @param[in]	qps			Rate
+         * @return		qint64		Requests scheduled at or before elapsedMs
+         */
+        static qint64	dueBy(qint64 elapsedMs, double qps);
+
+    public slots:
+        /**
+         * Starts sending requests.
+         */
+        void	start(void);
+
+    private slots:
+        void	tick(void);
+        void	replyFinished(void);
+
+    signals:
+        /**
+         * Emitted when the limits are reached and every request is answered
+         */
+        void	finished(void);
+};
+
+#endif // MXLOADGENERATOR_HPP
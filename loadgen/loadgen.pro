@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Load generation tool built on MXRequestManager
+#
+#-------------------------------------------------
+
+QT          +=  network
+QT          -=  gui
+
+TARGET      =   mxloadgen
+CONFIG      +=  console
+CONFIG      -=  app_bundle
+
+TEMPLATE    =   app
+LIBS        +=  -L$$shadowed(../src) -lMXRequestManager2
+
+SOURCES     +=  main.cpp \
+                MXLoadGenerator.cpp
+HEADERS     +=  MXLoadGenerator.hpp
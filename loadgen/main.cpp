@@ -0,0 +1,111 @@
+/**
+ * @file		main.cpp
+ * @brief		mxloadgen
+ *
+ * @details		Load generation tool built on MXRequestManager
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include "MXLoadGenerator.hpp"
+
+int	main(int argc, char **argv)
+{
+    QCoreApplication	app(argc, argv);
+    QCommandLineParser	parser;
+    QTextStream			out(stdout);
+    QTextStream			err(stderr);
+
+    app.setApplicationName("mxloadgen");
+    app.setApplicationVersion(MXREQUESTMANAGER_VERSION);
+
+    parser.setApplicationDescription("Drives MXRequestManager against a URL or a recorded "
+                                     "request mix, then reports throughput, errors and "
+                                     "latency percentiles.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions(QList<QCommandLineOption>()
+        << QCommandLineOption(QStringList() << "u" << "url",
+                              "Target URL (scheme://host[:port]/resource[?query]).", "url")
+        << QCommandLineOption(QStringList() << "r" << "replay",
+                              "Request mix captured by MXRequestRecorder. Its paths are sent "
+                              "to the --url host.", "file")
+        << QCommandLineOption(QStringList() << "X" << "method",
+                              "HTTP method used with --url (default: GET).", "method", "GET")
+        << QCommandLineOption(QStringList() << "q" << "qps",
+                              "Open loop: requests started per second (default: closed loop).",
+                              "qps", "0")
+        << QCommandLineOption(QStringList() << "c" << "concurrency",
+                              "Closed loop: requests in flight (default: 1). Open loop: maximum "
+                              "in flight, 0 for unbounded (default: 0).", "n")
+        << QCommandLineOption(QStringList() << "d" << "duration",
+                              "Run duration in seconds, 0 for none (default: 10).", "s", "10")
+        << QCommandLineOption(QStringList() << "n" << "requests",
+                              "Number of requests to send, 0 for none (default: 0).", "n", "0"));
+    parser.process(app);
+
+    QUrl					url = QUrl::fromUserInput(parser.value("url"));
+    QUrl					baseUrl;
+    QList<MXRequestRecord>	mix;
+
+    if (!parser.isSet("url"))
+    {
+        err << "A target --url is required." << '\n';
+        return (1);
+    }
+    if (parser.isSet("replay"))
+    {
+        bool	ok;
+
+        mix = MXRequestRecorder::readAll(parser.value("replay"), &ok);
+        if (!ok || mix.isEmpty())
+        {
+            err << "Can't read any request from " << parser.value("replay") << '\n';
+            return (1);
+        }
+    }
+    else
+    {
+        MXRequestRecord	record;
+
+        record.method = parser.value("method").toUpper();
+        record.url = url;
+        mix.append(record);
+    }
+
+    baseUrl.setScheme(url.scheme());
+    baseUrl.setAuthority(url.authority());
+
+    MXRequestManager	manager(baseUrl);
+    MXLoadGenerator		generator(&manager);
+
+    generator.setMix(mix);
+    generator.setQps(parser.value("qps").toDouble());
+    if (parser.isSet("concurrency"))
+        generator.setConcurrency(parser.value("concurrency").toInt());
+    generator.setLimits(qint64(parser.value("duration").toDouble() * 1000),
+                        parser.value("requests").toLongLong());
+
+    QObject::connect(&generator, SIGNAL(finished()), &app, SLOT(quit()));
+    QMetaObject::invokeMethod(&generator, "start", Qt::QueuedConnection);
+    app.exec();
+
+    generator.report(out);
+    out.flush();
+    return (0);
+}
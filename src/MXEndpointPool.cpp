@@ -0,0 +1,249 @@
+/**
+ * @file		MXEndpointPool.cpp
+ * @brief		MXEndpointPool
+ *
+ * @details		Load balancing between equivalent base URLs
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QMutexLocker>
+
+#include "MXEndpointPool.hpp"
+
+#define	EWMA_WEIGHT			0.3			// Weight of the last sample
+#define	EWMA_PENALTY		1000000.0	// us, sample of a failure, or twice the average
+#define	EWMA_PENALTY_MAX	10000000.0	// us, cap of the doubled average
+
+// Constructors
+MXEndpointPool::MXEndpointPool(QList<QUrl> const& urls, Strategy strategy)
+    : m_strategy(strategy), m_maxFailures(5), m_cooldown(30000), m_cursor(0)
+{
+    int	i = -1;
+
+    while (++i < urls.size())
+    {
+        Endpoint	endpoint;
+
+        endpoint.url = urls.at(i);
+        endpoint.outstanding = 0;
+        endpoint.failures = 0;
+        endpoint.ewma = 0;
+        endpoint.sampled = false;
+        endpoint.ejectedUntil = 0;
+        this->m_endpoints.append(endpoint);
+    }
+    this->m_clock.start();
+}
+// ---
+
+// Getters / Setters
+QList<QUrl>	MXEndpointPool::urls(void) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+    QList<QUrl>		urls;
+    int				i = -1;
+
+    while (++i < this->m_endpoints.size())
+        urls.append(this->m_endpoints.at(i).url);
+    return (urls);
+}
+
+int		MXEndpointPool::size(void) const
+{
+    return (this->m_endpoints.size()); // Never changes
+}
+
+QUrl	MXEndpointPool::url(int index) const
+{
+    return (this->m_endpoints.value(index).url);
+}
+
+void	MXEndpointPool::setStrategy(Strategy strategy)
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    this->m_strategy = strategy;
+}
+
+MXEndpointPool::Strategy	MXEndpointPool::strategy(void) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    return (this->m_strategy);
+}
+
+void	MXEndpointPool::setEjection(int failures, int cooldown)
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    this->m_maxFailures = failures;
+    this->m_cooldown = cooldown;
+}
+
+int		MXEndpointPool::outstanding(int index) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    return (this->m_endpoints.value(index).outstanding);
+}
+
+double	MXEndpointPool::ewma(int index) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    return (this->m_endpoints.value(index).ewma);
+}
+
+bool	MXEndpointPool::isHealthy(int index) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    return (index >= 0 && index < this->m_endpoints.size()
+            && this->m_endpoints.at(index).ejectedUntil <= this->m_clock.elapsed());
+}
+
+quint64	MXEndpointPool::samples(void) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    return (this->m_latency.count() + this->m_previous.count());
+}
+
+quint64	MXEndpointPool::latencyPercentile(double percentile) const
+{
+    QMutexLocker		lock(&this->m_mutex);
+    MXLatencyHistogram	window(this->m_previous);
+
+    window.merge(this->m_latency);
+    return (window.percentile(percentile));
+}
+// ---
+
+// Treatments
+int		MXEndpointPool::pick(int exclude)
+{
+    QMutexLocker	lock(&this->m_mutex);
+    qint64			now = this->m_clock.elapsed();
+    int				size = this->m_endpoints.size();
+    int				best = -1;
+    double			bestScore = 0;
+    double			score;
+    int				index;
+    int				i = -1;
+
+    while (++i < size)
+    {
+        index = (this->m_cursor + i) % size;
+
+        Endpoint	&endpoint = this->m_endpoints[index];
+
+        if (endpoint.ejectedUntil != 0 && endpoint.ejectedUntil <= now) // Readmitted
+        {
+            endpoint.failures = 0;
+            endpoint.ejectedUntil = 0;
+        }
+        if (index == exclude || endpoint.ejectedUntil > now)
+            continue;
+        if (this->m_strategy == Ewma) // Not sampled yet: tried first
+            score = endpoint.sampled ? endpoint.ewma * (endpoint.outstanding + 1) : 0;
+        else
+            score = endpoint.outstanding;
+        if (best < 0 || score < bestScore)
+        {
+            best = index;
+            bestScore = score;
+        }
+    }
+
+    if (best < 0) // Every endpoint is ejected: use the one coming back first
+    {
+        i = -1;
+        while (++i < size)
+            if (i != exclude && (best < 0 || this->m_endpoints.at(i).ejectedUntil
+                                             < this->m_endpoints.at(best).ejectedUntil))
+                best = i;
+        if (best < 0)
+            return (-1);
+    }
+
+    this->m_cursor = (best + 1) % size;
+    ++this->m_endpoints[best].outstanding;
+    return (best);
+}
+
+void	MXEndpointPool::release(int index, qint64 latency, bool ok)
+{
+    QMutexLocker	lock(&this->m_mutex);
+    Endpoint		*endpoint;
+    double			sample;
+
+    if (index < 0 || index >= this->m_endpoints.size())
+        return;
+    endpoint = &this->m_endpoints[index];
+    if (endpoint->outstanding > 0)
+        --endpoint->outstanding;
+    if (latency < 0)
+        return;
+
+    if (!ok)
+    {
+        sample = qMax(qMax(double(latency), EWMA_PENALTY),
+                      qMin(2 * endpoint->ewma, EWMA_PENALTY_MAX));
+        endpoint->ewma = endpoint->sampled ? EWMA_WEIGHT * sample
+                                             + (1 - EWMA_WEIGHT) * endpoint->ewma
+                                           : sample;
+        endpoint->sampled = true;
+        if (this->m_maxFailures > 0 && ++endpoint->failures >= this->m_maxFailures)
+            endpoint->ejectedUntil = this->m_clock.elapsed() + this->m_cooldown;
+        return;
+    }
+
+    endpoint->failures = 0;
+    endpoint->ejectedUntil = 0;
+    endpoint->ewma = endpoint->sampled ? EWMA_WEIGHT * latency
+                                         + (1 - EWMA_WEIGHT) * endpoint->ewma
+                                       : double(latency);
+    endpoint->sampled = true;
+
+    if (this->m_latency.count() >= MXENDPOINTPOOL_WINDOW)
+    {
+        this->m_previous = this->m_latency;
+        this->m_latency.reset();
+    }
+    this->m_latency.record(quint64(latency));
+}
+
+QUrl	MXEndpointPool::rebase(QUrl const& url, int from, int to) const
+{
+    QUrl	source = this->url(from);
+    QUrl	target = this->url(to);
+    QUrl	rebased(url);
+    QString	sourcePath = source.path();
+    QString	targetPath = target.path();
+
+    if (sourcePath.endsWith('/'))
+        sourcePath.chop(1);
+    if (targetPath.endsWith('/'))
+        targetPath.chop(1);
+
+    rebased.setScheme(target.scheme());
+    rebased.setAuthority(target.authority());
+    if (!sourcePath.isEmpty() && url.path().startsWith(sourcePath))
+        rebased.setPath(targetPath + url.path().mid(sourcePath.size()));
+    else if (sourcePath.isEmpty() && !targetPath.isEmpty())
+        rebased.setPath(targetPath + url.path());
+    return (rebased);
+}
+// ---
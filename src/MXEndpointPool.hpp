@@ -0,0 +1,188 @@
+/**
+ * @brief		MXEndpointPool
+ *
+ * @details		Load balancing between equivalent base URLs
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXENDPOINTPOOL_HPP
+# define	MXENDPOINTPOOL_HPP
+
+# include	<QElapsedTimer>
+# include	<QList>
+# include	<QMutex>
+# include	<QUrl>
+# include	<QVector>
+
+# include	"MXLatencyHistogram.hpp"
+
+# define	MXENDPOINTPOOL_WINDOW	1000	// Latencies kept for the percentiles
+
+/**
+ * @class	MXEndpointPool
+ * @brief	Picks one of several equivalent base URLs for each request
+ *
+ * Endpoints failing several times in a row (network errors, HTTP 5xx) are
+ * ejected for a cooldown period, then tried again with a clean slate. If
+ * every endpoint is ejected, the one coming back first is used anyway.
+ *
+ * Failures count in the latency average of the Ewma strategy as a penalty
+ * (1 s, or twice the average if it's higher, up to 10 s), so an endpoint
+ * failing fast doesn't look fast, yet recovers in a few successes.
+ *
+ * Latencies are also kept over a sliding window of about WINDOW to
+ * 2 * WINDOW requests, for the hedging delay of MXRequestManager.
+ * A pool is shared by the copies of a manager, and is thread-safe.
+ */
+
+class MXEndpointPool
+{
+    public:
+        /**
+        * @enum
+        */
+        enum Strategy
+        {
+            LeastOutstanding = 0,	// Default: fewest requests in flight
+            Ewma					// Lowest latency average, weighted by the requests in flight
+        };
+
+    private:
+        struct Endpoint
+        {
+            QUrl	url;
+            int		outstanding;
+            int		failures;		// In a row
+            double	ewma;			// us
+            bool	sampled;		// FALSE until ewma has a first sample
+            qint64	ejectedUntil;	// On m_clock, 0 if healthy
+        };
+
+        mutable QMutex		m_mutex;
+        QVector<Endpoint>	m_endpoints;
+        Strategy			m_strategy;
+        int					m_maxFailures;
+        int					m_cooldown;
+        int					m_cursor;		// Round-robin between ties
+        QElapsedTimer		m_clock;
+        MXLatencyHistogram	m_latency;		// Current window
+        MXLatencyHistogram	m_previous;		// Previous window
+
+    public:
+        /**
+         * Constructs a pool of equivalent base URLs.
+         *
+         * @param[in]	urls		Base URLs, at least one
+         * @param[in]	strategy	Selection strategy
+         */
+        MXEndpointPool(QList<QUrl> const& urls, Strategy strategy = LeastOutstanding);
+
+        /**
+         * Get the base URLs
+         */
+        QList<QUrl>	urls(void) const;
+
+        /**
+         * Get the number of base URLs
+         */
+        int			size(void) const;
+
+        /**
+         * Get the base URL of an endpoint
+         */
+        QUrl		url(int index) const;
+
+        /**
+         * Set the selection strategy
+         */
+        void		setStrategy(Strategy strategy);
+
+        /**
+         * Get the selection strategy
+         */
+        Strategy	strategy(void) const;
+
+        /**
+         * Set when an endpoint is ejected (default: 5 failures, for 30 s).
+         *
+         * @param[in]	failures	Failures in a row before ejection, 0 to never eject
+         * @param[in]	cooldown	Time an ejected endpoint isn't used (ms)
+         * @return		void
+         */
+        void		setEjection(int failures, int cooldown);
+
+        /**
+         * Get the number of requests in flight to an endpoint
+         */
+        int			outstanding(int index) const;
+
+        /**
+         * Get the average latency of an endpoint, in microseconds,
+         * failures included. 0 until its first request is over.
+         */
+        double		ewma(int index) const;
+
+        /**
+         * Get the health state of an endpoint
+         *
+         * @param[in]	index	Endpoint
+         * @return		bool	FALSE while the endpoint is ejected
+         */
+        bool		isHealthy(int index) const;
+
+        /**
+         * Get the number of latencies in the current window
+         */
+        quint64		samples(void) const;
+
+        /**
+         * Get a percentile of the recent latencies, in microseconds.
+         *
+         * @param[in]	percentile	Between 0 and 100
+         * @return		quint64		Latency, 0 without samples
+         */
+        quint64		latencyPercentile(double percentile) const;
+
+        /**
+         * Picks the endpoint of a request, and counts it in flight.
+         *
+         * @param[in]	exclude	Endpoint not to pick (-1 for none)
+         * @return		int		Picked endpoint, -1 if none but the excluded one
+         */
+        int			pick(int exclude = -1);
+
+        /**
+         * Called when a request to an endpoint is over.
+         *
+         * @param[in]	index	Endpoint
+         * @param[in]	latency	Latency in microseconds, -1 for no sample (aborted)
+         * @param[in]	ok		FALSE on a network error or an HTTP 5xx
+         * @return		void
+         */
+        void		release(int index, qint64 latency, bool ok);
+
+        /**
+         * Moves a URL from an endpoint to another one: scheme, authority and
+         * base path are replaced, the resource and query are kept.
+         *
+         * @param[in]	url		URL built on the first endpoint
+         * @param[in]	from	Endpoint of the URL
+         * @param[in]	to		New endpoint
+         * @return		QUrl	URL on the new endpoint
+         */
+        QUrl		rebase(QUrl const& url, int from, int to) const;
+};
+
+#endif // MXENDPOINTPOOL_HPP
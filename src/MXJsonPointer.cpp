@@ -0,0 +1,275 @@
+/**
+ * @file		MXJsonPointer.cpp
+ * @brief		MXJsonPointer
+ *
+ * @details		JSON Pointer (RFC 6901) lookups on raw JSON, without a full parse
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QStringList>
+
+#include <cstring>
+
+#include "MXJsonPointer.hpp"
+
+// Constructors
+MXJsonPointer::MXJsonPointer(QString const& pointer) : m_valid(true)
+{
+    QStringList	tokens;
+    int			i = -1;
+
+    if (pointer.isEmpty())
+        return;
+    if (!pointer.startsWith('/'))
+    {
+        this->m_valid = false;
+        return;
+    }
+
+    tokens = pointer.mid(1).split('/');
+    while (++i < tokens.size())
+        this->m_tokens.append(QString(tokens.at(i)).replace("~1", "/").replace("~0", "~")
+                              .toUtf8());
+}
+// ---
+
+// Getters
+bool	MXJsonPointer::isValid(void) const
+{
+    return (this->m_valid);
+}
+// ---
+
+// Scanner
+namespace
+{
+    struct CharClasses
+    {
+        bool	structural[256];	// Bytes stopping the scan of a container
+        bool	delimiter[256];		// Bytes ending a scalar
+
+        CharClasses(void)
+        {
+            std::memset(this->structural, 0, sizeof(this->structural));
+            std::memset(this->delimiter, 0, sizeof(this->delimiter));
+            this->structural[int('"')] = this->structural[int('{')] = true;
+            this->structural[int('}')] = this->structural[int('[')] = true;
+            this->structural[int(']')] = true;
+            this->delimiter[int(',')] = this->delimiter[int('}')] = true;
+            this->delimiter[int(']')] = this->delimiter[int(' ')] = true;
+            this->delimiter[int('\n')] = this->delimiter[int('\r')] = true;
+            this->delimiter[int('\t')] = true;
+        }
+    };
+}
+
+int		MXJsonPointer::skipSpaces(char const *json, int pos, int size)
+{
+    while (pos < size && (json[pos] == ' ' || json[pos] == '\n'
+                          || json[pos] == '\r' || json[pos] == '\t'))
+        ++pos;
+    return (pos);
+}
+
+int		MXJsonPointer::skipString(char const *json, int pos, int size)
+{
+    char const	*quote;
+    int			from = pos + 1;
+    int			backslashes;
+
+    while (from < size)
+    {
+        if ((quote = static_cast<char const*>(std::memchr(json + from, '"',
+                                                            size_t(size - from)))) == NULL)
+            return (-1);
+        from = int(quote - json);
+        backslashes = 0;
+        while (from - backslashes - 1 > pos && json[from - backslashes - 1] == '\\')
+            ++backslashes;
+        if (backslashes % 2 == 0)
+            return (from + 1);
+        ++from;
+    }
+    return (-1);
+}
+
+int		MXJsonPointer::skipValue(char const *json, int pos, int size)
+{
+    static CharClasses const	classes;
+    int							depth = 1;
+
+    if (pos >= size)
+        return (-1);
+    if (json[pos] == '"')
+        return (skipString(json, pos, size));
+
+    if (json[pos] != '{' && json[pos] != '[') // Scalar
+    {
+        int	begin = pos;
+
+        while (pos < size && !classes.delimiter[static_cast<unsigned char>(json[pos])])
+            ++pos;
+        return (pos > begin ? pos : -1);
+    }
+
+    ++pos;
+    while (pos < size)
+    {
+        while (pos < size && !classes.structural[static_cast<unsigned char>(json[pos])])
+            ++pos;
+        if (pos >= size)
+            return (-1);
+        if (json[pos] == '"')
+        {
+            if ((pos = skipString(json, pos, size)) < 0)
+                return (-1);
+            continue;
+        }
+        if (json[pos] == '{' || json[pos] == '[')
+            ++depth;
+        else if (--depth == 0)
+            return (pos + 1);
+        ++pos;
+    }
+    return (-1);
+}
+
+bool	MXJsonPointer::keyEquals(char const *json, int begin, int end,
+                                 QByteArray const& token)
+{
+    QByteArray	key;
+
+    if (std::memchr(json + begin, '\\', size_t(end - begin)) == NULL)
+        return (end - begin == token.size()
+                && std::memcmp(json + begin, token.constData(), size_t(token.size())) == 0);
+
+    // Escaped key: let QJsonDocument decode it
+    key = QByteArray("[").append(json + begin - 1, end - begin + 2).append(']');
+    return (QJsonDocument::fromJson(key).array().at(0).toString().toUtf8() == token);
+}
+// ---
+
+// Treatments
+bool	MXJsonPointer::find(QByteArray const& json, int *begin, int *end) const
+{
+    char const	*data = json.constData();
+    int			size = json.size();
+    int			pos;
+    int			keyEnd;
+    int			index;
+    int			i = -1;
+    bool		ok;
+
+    if (!this->m_valid)
+        return (false);
+
+    pos = skipSpaces(data, 0, size);
+    while (++i < this->m_tokens.size())
+    {
+        QByteArray const&	token = this->m_tokens.at(i);
+
+        if (pos >= size)
+            return (false);
+        if (data[pos] == '{')
+        {
+            pos = skipSpaces(data, pos + 1, size);
+            while (true)
+            {
+                if (pos >= size || data[pos] != '"'
+                    || (keyEnd = skipString(data, pos, size)) < 0)
+                    return (false);
+                ok = keyEquals(data, pos + 1, keyEnd - 1, token);
+                pos = skipSpaces(data, keyEnd, size);
+                if (pos >= size || data[pos] != ':')
+                    return (false);
+                pos = skipSpaces(data, pos + 1, size);
+                if (ok)
+                    break;
+                if ((pos = skipValue(data, pos, size)) < 0)
+                    return (false);
+                pos = skipSpaces(data, pos, size);
+                if (pos >= size || data[pos] != ',')
+                    return (false); // End of object: not found
+                pos = skipSpaces(data, pos + 1, size);
+            }
+        }
+        else if (data[pos] == '[')
+        {
+            index = token.toInt(&ok);
+            if (!ok || index < 0 || (token.size() > 1 && token.at(0) == '0')
+                || token.at(0) == '+' || token.at(0) == '-')
+                return (false);
+            pos = skipSpaces(data, pos + 1, size);
+            if (pos >= size || data[pos] == ']')
+                return (false);
+            while (index-- > 0)
+            {
+                if ((pos = skipValue(data, pos, size)) < 0)
+                    return (false);
+                pos = skipSpaces(data, pos, size);
+                if (pos >= size || data[pos] != ',')
+                    return (false); // End of array: out of range
+                pos = skipSpaces(data, pos + 1, size);
+            }
+        }
+        else
+            return (false);
+    }
+
+    if ((keyEnd = skipValue(data, pos, size)) < 0)
+        return (false);
+    if (begin)
+        *begin = pos;
+    if (end)
+        *end = keyEnd;
+    return (true);
+}
+
+QByteArray	MXJsonPointer::raw(QByteArray const& json) const
+{
+    int	begin;
+    int	end;
+
+    if (!this->find(json, &begin, &end))
+        return (QByteArray());
+    return (json.mid(begin, end - begin));
+}
+
+QVariant	MXJsonPointer::value(QByteArray const& json, bool *found) const
+{
+    QByteArray		raw = this->raw(json);
+    QJsonParseError	jsonErr;
+    QVariant		value;
+
+    if (found)
+        *found = false;
+    if (raw.isNull())
+        return (QVariant());
+
+    if (raw.at(0) == '{' || raw.at(0) == '[')
+        value = QJsonDocument::fromJson(raw, &jsonErr).toVariant();
+    else // Scalars only parse inside a container
+        value = QJsonDocument::fromJson("[" + raw + "]", &jsonErr).array().at(0).toVariant();
+
+    if (jsonErr.error != QJsonParseError::NoError)
+        return (QVariant());
+    if (found)
+        *found = true;
+    return (value);
+}
+// ---
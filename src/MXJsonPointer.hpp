@@ -0,0 +1,95 @@
+/**
+ * @brief		MXJsonPointer
+ *
+ * @details		JSON Pointer (RFC 6901) lookups on raw JSON, without a full parse
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXJSONPOINTER_HPP
+# define	MXJSONPOINTER_HPP
+
+# include	<QByteArray>
+# include	<QList>
+# include	<QString>
+# include	<QVariant>
+
+/**
+ * @class	MXJsonPointer
+ * @brief	Locates a value in a JSON document from its JSON Pointer
+ *
+ * The document is walked with a structural scanner: members and elements
+ * which aren't on the pointer's path are skipped without being decoded
+ * (strings are skipped with memchr()), and only the targeted value is parsed.
+ * Skipped subtrees aren't validated, so a malformed document may still give
+ * a value if the path to it is well formed.
+ */
+
+class MXJsonPointer
+{
+    private:
+        QList<QByteArray>	m_tokens;	// Unescaped, UTF-8
+        bool				m_valid;
+
+        static int	skipSpaces(char const *json, int pos, int size);
+        static int	skipString(char const *json, int pos, int size);
+        static int	skipValue(char const *json, int pos, int size);
+        static bool	keyEquals(char const *json, int begin, int end, QByteArray const& token);
+
+    public:
+        /**
+         * Constructs a pointer from its string representation ("/a/0/b~1c").
+         * An empty string points to the whole document.
+         *
+         * @param[in]	pointer	JSON Pointer
+         */
+        MXJsonPointer(QString const& pointer);
+
+        /**
+         * Get the syntax state of the pointer
+         *
+         * @param		void
+         * @return		bool	FALSE if the pointer isn't empty and doesn't start with '/'
+         */
+        bool	isValid(void) const;
+
+        /**
+         * Locates the raw JSON text of the pointed value.
+         *
+         * @param[in]	json	JSON document
+         * @param[out]	begin	Offset of the first byte of the value
+         * @param[out]	end		Offset after the last byte of the value
+         * @return		bool	FALSE if the value can't be found
+         */
+        bool	find(QByteArray const& json, int *begin, int *end) const;
+
+        /**
+         * Get the raw JSON text of the pointed value.
+         *
+         * @param[in]	json		JSON document
+         * @return		QByteArray	Raw value, null if not found
+         */
+        QByteArray	raw(QByteArray const& json) const;
+
+        /**
+         * Get the pointed value, as QJsonDocument::toVariant() would give it.
+         *
+         * @param[in]	json	JSON document
+         * @param[out]	found	Set to TRUE if the value was found and parsed (Optional)
+         * @return		QVariant	Value, invalid if not found
+         */
+        QVariant	value(QByteArray const& json, bool *found = 0) const;
+};
+
+#endif // MXJSONPOINTER_HPP
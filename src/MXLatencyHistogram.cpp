@@ -0,0 +1,174 @@
+/**
+ * @file		MXLatencyHistogram.cpp
+ * @brief		MXLatencyHistogram
+ *
+ * @details		Log-linear (HDR style) latency histogram
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QtAlgorithms>
+
+#include "MXLatencyHistogram.hpp"
+
+#define	SUB_COUNT	(1 << MXLATENCYHISTOGRAM_SUB_BITS)
+#define	MAX_VALUE	((Q_UINT64_C(1) << MXLATENCYHISTOGRAM_MAX_BITS) - 1)
+#define	BUCKETS		((MXLATENCYHISTOGRAM_MAX_BITS - MXLATENCYHISTOGRAM_SUB_BITS + 1) * SUB_COUNT)
+
+// Constructors
+MXLatencyHistogram::MXLatencyHistogram(void)
+    : m_counts(BUCKETS, 0), m_total(0), m_sum(0), m_min(0), m_max(0)
+{
+}
+// ---
+
+// Buckets
+int		MXLatencyHistogram::bucketOf(quint64 value)
+{
+    int	exponent;
+
+    if (value < SUB_COUNT)
+        return (int(value));
+    exponent = 63 - qCountLeadingZeroBits(value);
+    return ((exponent - MXLATENCYHISTOGRAM_SUB_BITS + 1) * SUB_COUNT
+            + int((value >> (exponent - MXLATENCYHISTOGRAM_SUB_BITS)) & (SUB_COUNT - 1)));
+}
+
+quint64	MXLatencyHistogram::lowestOf(int bucket)
+{
+    int	exponent;
+
+    if (bucket < SUB_COUNT)
+        return (quint64(bucket));
+    exponent = bucket / SUB_COUNT + MXLATENCYHISTOGRAM_SUB_BITS - 1;
+    return (quint64(SUB_COUNT + bucket % SUB_COUNT) << (exponent - MXLATENCYHISTOGRAM_SUB_BITS));
+}
+
+quint64	MXLatencyHistogram::highestOf(int bucket)
+{
+    if (bucket + 1 >= BUCKETS)
+        return (MAX_VALUE);
+    return (lowestOf(bucket + 1) - 1);
+}
+// ---
+
+// Treatments
+void	MXLatencyHistogram::record(quint64 value)
+{
+    if (value > MAX_VALUE)
+        value = MAX_VALUE;
+
+    ++this->m_counts[bucketOf(value)];
+    if (this->m_total == 0 || value < this->m_min)
+        this->m_min = value;
+    if (value > this->m_max)
+        this->m_max = value;
+    ++this->m_total;
+    this->m_sum += value;
+}
+
+void	MXLatencyHistogram::merge(MXLatencyHistogram const& other)
+{
+    int	i = -1;
+
+    if (other.m_total == 0)
+        return;
+    while (++i < BUCKETS)
+        this->m_counts[i] += other.m_counts.at(i);
+    if (this->m_total == 0 || other.m_min < this->m_min)
+        this->m_min = other.m_min;
+    if (other.m_max > this->m_max)
+        this->m_max = other.m_max;
+    this->m_total += other.m_total;
+    this->m_sum += other.m_sum;
+}
+
+void	MXLatencyHistogram::reset(void)
+{
+    this->m_counts.fill(0);
+    this->m_total = 0;
+    this->m_sum = 0;
+    this->m_min = 0;
+    this->m_max = 0;
+}
+// ---
+
+// Getters
+quint64	MXLatencyHistogram::count(void) const
+{
+    return (this->m_total);
+}
+
+quint64	MXLatencyHistogram::sum(void) const
+{
+    return (this->m_sum);
+}
+
+quint64	MXLatencyHistogram::min(void) const
+{
+    return (this->m_min);
+}
+
+quint64	MXLatencyHistogram::max(void) const
+{
+    return (this->m_max);
+}
+
+double	MXLatencyHistogram::mean(void) const
+{
+    if (this->m_total == 0)
+        return (0);
+    return (double(this->m_sum) / double(this->m_total));
+}
+
+quint64	MXLatencyHistogram::percentile(double percentile) const
+{
+    quint64	rank;
+    quint64	seen = 0;
+    int		i = -1;
+
+    if (this->m_total == 0)
+        return (0);
+    if (percentile >= 100)
+        return (this->m_max);
+
+    rank = quint64(percentile / 100.0 * double(this->m_total) + 0.5);
+    if (rank < 1)
+        rank = 1;
+    while (++i < BUCKETS)
+    {
+        seen += this->m_counts.at(i);
+        if (seen >= rank)
+            return (qMin(highestOf(i), this->m_max));
+    }
+    return (this->m_max);
+}
+
+quint64	MXLatencyHistogram::bucketCeiling(quint64 value)
+{
+    return (highestOf(bucketOf(qMin(value, MAX_VALUE))));
+}
+
+quint64	MXLatencyHistogram::countAtOrBelow(quint64 value) const
+{
+    quint64	seen = 0;
+    int		last;
+    int		i = -1;
+
+    last = bucketOf(qMin(value, MAX_VALUE));
+    while (++i <= last)
+        seen += this->m_counts.at(i);
+    return (seen);
+}
+// ---
@@ -0,0 +1,134 @@
+/**
+ * @brief		MXLatencyHistogram
+ *
+ * @details		Log-linear (HDR style) latency histogram
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXLATENCYHISTOGRAM_HPP
+# define	MXLATENCYHISTOGRAM_HPP
+
+# include	<QVector>
+# include	<QtGlobal>
+
+# define	MXLATENCYHISTOGRAM_SUB_BITS		5	// 32 sub-buckets per power of 2 (~3% error)
+# define	MXLATENCYHISTOGRAM_MAX_BITS		40	// Values are clamped to 2^40 - 1
+
+/**
+ * @class	MXLatencyHistogram
+ * @brief	Records values (usually microseconds) in log-linear buckets
+ *
+ * Values below 2^SUB_BITS are exact, others are kept with a relative error
+ * bounded by 2^-SUB_BITS. Recording is a couple of shifts and an increment,
+ * and the memory footprint is fixed (about 10 KiB).
+ */
+
+class MXLatencyHistogram
+{
+    private:
+        QVector<quint64>	m_counts;
+        quint64				m_total;
+        quint64				m_sum;
+        quint64				m_min;
+        quint64				m_max;
+
+        static int			bucketOf(quint64 value);
+        static quint64		lowestOf(int bucket);
+        static quint64		highestOf(int bucket);
+
+    public:
+        /**
+         * Constructs an empty histogram
+         */
+        MXLatencyHistogram(void);
+
+        /**
+         * Records a value.
+         *
+         * @param[in]	value	Value to record, clamped to the maximum
+         * @return		void
+         */
+        void	record(quint64 value);
+
+        /**
+         * Adds every value of another histogram to this one.
+         *
+         * @param[in]	other	Histogram to merge
+         * @return		void
+         */
+        void	merge(MXLatencyHistogram const& other);
+
+        /**
+         * Removes every recorded value.
+         *
+         * @param		void
+         * @return		void
+         */
+        void	reset(void);
+
+        /**
+         * Get the number of recorded values
+         */
+        quint64	count(void) const;
+
+        /**
+         * Get the sum of recorded values
+         */
+        quint64	sum(void) const;
+
+        /**
+         * Get the smallest recorded value, 0 if empty
+         */
+        quint64	min(void) const;
+
+        /**
+         * Get the highest recorded value, 0 if empty
+         */
+        quint64	max(void) const;
+
+        /**
+         * Get the mean of recorded values, 0 if empty
+         */
+        double	mean(void) const;
+
+        /**
+         * Get the value at the given percentile.
+         *
+         * @param[in]	percentile	Between 0 and 100
+         * @return		quint64		Highest value of the bucket holding the percentile,
+         *							0 if empty
+         */
+        quint64	percentile(double percentile) const;
+
+        /**
+         * Get the number of values recorded at or below the given value,
+         * rounded to the bucket boundary (used for cumulative exports).
+         * Exact for the values returned by bucketCeiling().
+         *
+         * @param[in]	value	Upper bound
+         * @return		quint64	Number of values <= bucketCeiling(value)
+         */
+        quint64	countAtOrBelow(quint64 value) const;
+
+        /**
+         * Get the highest value kept in the same bucket as the given one.
+         *
+         * @param[in]	value	Any value, clamped to the maximum
+         * @return		quint64	Bucket boundary, at most 2^-SUB_BITS above value
+         */
+        static quint64	bucketCeiling(quint64 value);
+};
+
+#endif // MXLATENCYHISTOGRAM_HPP
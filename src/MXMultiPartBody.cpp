@@ -0,0 +1,213 @@
+/**
+ * @file		MXMultiPartBody.cpp
+ * @brief		MXMultiPartBody
+ *
+ * @details		Streaming multipart/form-data body
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QFileInfo>
+#include <QUuid>
+
+#include <cstring>
+
+#include "MXMultiPartBody.hpp"
+
+#define	CRLF	"\r\n"
+
+// Constructors
+MXMultiPartBody::MXMultiPartBody(QObject *parent)
+    : QIODevice(parent), m_size(0), m_current(0)
+{
+    this->m_boundary = "MXBoundary" + QUuid::createUuid().toRfc4122().toHex();
+    this->m_trailer = "--" + this->m_boundary + "--" CRLF;
+    this->m_size = this->m_trailer.size();
+}
+
+MXMultiPartBody::~MXMultiPartBody()
+{
+    this->m_file.close();
+}
+// ---
+
+// Building
+QByteArray	MXMultiPartBody::escape(QString const& value)
+{
+    return (value.toUtf8().replace('"', "%22").replace('\r', "%0D").replace('\n', "%0A"));
+}
+
+void	MXMultiPartBody::appendPart(Part& part, QByteArray const& disposition,
+                                    QByteArray const& contentType)
+{
+    part.header = "--" + this->m_boundary + CRLF
+                  "Content-Disposition: form-data; " + disposition + CRLF;
+    if (!contentType.isEmpty())
+        part.header.append("Content-Type: ").append(contentType).append(CRLF);
+    part.header.append(CRLF);
+
+    part.offset = this->m_size - this->m_trailer.size();
+    this->m_size += part.header.size() + part.size + 2;
+    this->m_parts.append(part);
+}
+
+int		MXMultiPartBody::addField(QString const& name, QByteArray const& value)
+{
+    Part	part;
+
+    if (this->isOpen())
+        return (-1);
+
+    part.data = value;
+    part.size = value.size();
+    this->appendPart(part, "name=\"" + escape(name) + '"', QByteArray());
+    return (this->m_parts.size() - 1);
+}
+
+int		MXMultiPartBody::addFile(QString const& name, QString const& filePath,
+                                 QByteArray const& contentType)
+{
+    QFileInfo	info(filePath);
+    Part		part;
+
+    if (this->isOpen() || !info.isFile() || !info.isReadable())
+        return (-1);
+
+    part.filePath = info.absoluteFilePath();
+    part.size = info.size();
+    this->appendPart(part, "name=\"" + escape(name) + "\"; filename=\""
+                     + escape(info.fileName()) + '"', contentType);
+    return (this->m_parts.size() - 1);
+}
+// ---
+
+// Getters
+QByteArray	MXMultiPartBody::contentType(void) const
+{
+    return ("multipart/form-data; boundary=" + this->m_boundary);
+}
+
+int		MXMultiPartBody::count(void) const
+{
+    return (this->m_parts.size());
+}
+
+bool	MXMultiPartBody::isSequential(void) const
+{
+    return (false);
+}
+
+qint64	MXMultiPartBody::size(void) const
+{
+    return (this->m_size);
+}
+// ---
+
+// QIODevice
+bool	MXMultiPartBody::open(OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly)
+        return (false);
+    this->m_current = 0;
+    return (QIODevice::open(mode | QIODevice::Unbuffered));
+}
+
+void	MXMultiPartBody::close(void)
+{
+    this->m_file.close();
+    QIODevice::close();
+}
+
+bool	MXMultiPartBody::seek(qint64 pos)
+{
+    if (pos < 0 || pos > this->m_size || !QIODevice::seek(pos))
+        return (false);
+    this->m_current = 0;
+    return (true);
+}
+
+qint64	MXMultiPartBody::readData(char *data, qint64 maxSize)
+{
+    qint64	pos = this->pos();
+    qint64	done = 0;
+    qint64	n;
+    qint64	o;
+
+    while (done < maxSize && pos < this->m_size)
+    {
+        while (this->m_current < this->m_parts.size()
+               && pos >= this->m_parts.at(this->m_current).offset
+                         + this->m_parts.at(this->m_current).header.size()
+                         + this->m_parts.at(this->m_current).size + 2)
+            ++this->m_current;
+
+        if (this->m_current >= this->m_parts.size()) // Closing boundary
+        {
+            o = pos - (this->m_size - this->m_trailer.size());
+            n = qMin(maxSize - done, this->m_trailer.size() - o);
+            std::memcpy(data + done, this->m_trailer.constData() + o, size_t(n));
+        }
+        else
+        {
+            Part const&	part = this->m_parts.at(this->m_current);
+
+            o = pos - part.offset;
+            if (o < part.header.size())
+            {
+                n = qMin(maxSize - done, part.header.size() - o);
+                std::memcpy(data + done, part.header.constData() + o, size_t(n));
+            }
+            else if ((o -= part.header.size()) < part.size)
+            {
+                n = qMin(maxSize - done, part.size - o);
+                if (part.filePath.isEmpty())
+                    std::memcpy(data + done, part.data.constData() + o, size_t(n));
+                else
+                {
+                    if (this->m_file.fileName() != part.filePath || !this->m_file.isOpen())
+                    {
+                        this->m_file.close();
+                        this->m_file.setFileName(part.filePath);
+                        if (!this->m_file.open(QIODevice::ReadOnly))
+                            return (done > 0 ? done : -1);
+                    }
+                    if (this->m_file.pos() != o && !this->m_file.seek(o))
+                        return (done > 0 ? done : -1);
+                    if ((n = this->m_file.read(data + done, n)) <= 0)
+                        return (done > 0 ? done : -1); // File shrank
+                    if (o + n == part.size)
+                        this->m_file.close();
+                }
+                emit this->partProgress(this->m_current, o + n, part.size);
+            }
+            else
+            {
+                o -= part.size;
+                n = qMin(maxSize - done, 2 - o);
+                std::memcpy(data + done, CRLF + o, size_t(n));
+            }
+        }
+        pos += n;
+        done += n;
+    }
+    return (done);
+}
+
+qint64	MXMultiPartBody::writeData(char const *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return (-1);
+}
+// ---
@@ -0,0 +1,131 @@
+/**
+ * @brief		MXMultiPartBody
+ *
+ * @details		Streaming multipart/form-data body
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXMULTIPARTBODY_HPP
+# define	MXMULTIPARTBODY_HPP
+
+# include	<QByteArray>
+# include	<QFile>
+# include	<QIODevice>
+# include	<QList>
+# include	<QString>
+
+/**
+ * @class	MXMultiPartBody
+ * @brief	multipart/form-data body built from fields and file paths
+ * @extends	QIODevice
+ *
+ * Files are only opened (one at a time) when their part is read, and are
+ * streamed from disk, so the memory used doesn't depend on the upload size.
+ * The total size is known before sending, as long as the files are readable.
+ *
+ * Fill it with addField()/addFile(), then give it to MXRequestManager::request().
+ */
+
+class MXMultiPartBody : public QIODevice
+{
+    Q_OBJECT
+
+    private:
+        struct Part
+        {
+            QByteArray	header;		// Boundary and part headers
+            QByteArray	data;		// Field value
+            QString		filePath;	// Or file to stream
+            qint64		size;		// Size of the content
+            qint64		offset;		// Offset of the header in the body
+        };
+
+        QByteArray	m_boundary;
+        QByteArray	m_trailer;
+        QList<Part>	m_parts;
+        qint64		m_size;
+        int			m_current;
+        QFile		m_file;
+
+        void		appendPart(Part& part, QByteArray const& disposition,
+                               QByteArray const& contentType);
+        static QByteArray	escape(QString const& value);
+
+    protected:
+        qint64	readData(char *data, qint64 maxSize);
+        qint64	writeData(char const *data, qint64 maxSize);
+
+    public:
+        /**
+         * Constructs an empty body with a random boundary.
+         */
+        MXMultiPartBody(QObject *parent = 0);
+
+        /**
+         * Closes the file being streamed, if any.
+         */
+        ~MXMultiPartBody();
+
+        /**
+         * Appends a text field.
+         *
+         * @param[in]	name	Field name
+         * @param[in]	value	Field value
+         * @return		int		Index of the part
+         */
+        int		addField(QString const& name, QByteArray const& value);
+
+        /**
+         * Appends a file field, streamed from disk when sent.
+         *
+         * @param[in]	name		Field name
+         * @param[in]	filePath	Path of the file to send
+         * @param[in]	contentType	Content-Type of the part (Optional)
+         * @return		int			Index of the part, -1 if the file isn't readable
+         */
+        int		addFile(QString const& name, QString const& filePath,
+                        QByteArray const& contentType = "application/octet-stream");
+
+        /**
+         * Get the Content-Type header value, including the boundary
+         *
+         * @param		void
+         * @return		QByteArray	multipart/form-data; boundary=...
+         */
+        QByteArray	contentType(void) const;
+
+        /**
+         * Get the number of parts
+         */
+        int		count(void) const;
+
+        bool	open(OpenMode mode);
+        void	close(void);
+        bool	isSequential(void) const;
+        bool	seek(qint64 pos);
+        qint64	size(void) const;
+
+    signals:
+        /**
+         * Emitted when the content of a part is read for sending.
+         *
+         * @param	part		Index of the part, as returned by addField()/addFile()
+         * @param	bytesSent	Bytes of the part's content read so far
+         * @param	bytesTotal	Size of the part's content
+         */
+        void	partProgress(int part, qint64 bytesSent, qint64 bytesTotal);
+};
+
+#endif // MXMULTIPARTBODY_HPP
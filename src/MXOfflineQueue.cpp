@@ -0,0 +1,481 @@
+/**
+ * @file		MXOfflineQueue.cpp
+ * @brief		MXOfflineQueue
+ *
+ * @details		Durable outbound queue, replayed once the API is reachable
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QSaveFile>
+
+#include "MXOfflineQueue.hpp"
+
+#define	HEADER_SIZE	8	// Magic and version
+
+// Constructors
+MXOfflineQueue::MXOfflineQueue(MXRequestManager *manager, QString const& fileName,
+                               QObject *parent)
+    : QObject(parent), m_concurrency(4), m_probeInterval(5000), m_probeDelay(5000),
+      m_compactionSize(1024 * 1024), m_probeResource("/"), m_probeMethod("HEAD"),
+      m_online(true), m_pending(0), m_answered(0), m_lastId(0), m_watermark(0),
+      m_cursor(HEADER_SIZE), m_file(fileName), m_manager(manager), m_probe(NULL)
+{
+    this->m_probeTimer.setSingleShot(true);
+    connect(&this->m_probeTimer, SIGNAL(timeout()), SLOT(probe()));
+}
+
+MXOfflineQueue::~MXOfflineQueue()
+{
+    this->close();
+}
+// ---
+
+// Getters / Setters
+bool	MXOfflineQueue::isOpen(void) const
+{
+    return (this->m_file.isOpen());
+}
+
+bool	MXOfflineQueue::isOnline(void) const
+{
+    return (this->m_online);
+}
+
+int		MXOfflineQueue::pending(void) const
+{
+    return (this->m_pending);
+}
+
+void	MXOfflineQueue::setConcurrency(int max)
+{
+    this->m_concurrency = qMax(1, max);
+    this->dispatch();
+}
+
+int		MXOfflineQueue::concurrency(void) const
+{
+    return (this->m_concurrency);
+}
+
+void	MXOfflineQueue::setProbe(QString const& resource, QString const& method, int interval)
+{
+    this->m_probeResource = resource;
+    this->m_probeMethod = method;
+    this->m_probeInterval = qMax(1, interval);
+    this->m_probeDelay = this->m_probeInterval;
+}
+
+void	MXOfflineQueue::setCompactionSize(qint64 bytes)
+{
+    this->m_compactionSize = bytes;
+}
+
+bool	MXOfflineQueue::isAcknowledged(quint64 id) const
+{
+    return (id <= this->m_watermark || this->m_acked.contains(id));
+}
+
+void	MXOfflineQueue::setOnline(bool online)
+{
+    if (online == this->m_online)
+        return;
+
+    this->m_online = online;
+    if (online)
+    {
+        this->m_probeTimer.stop();
+        this->m_probeDelay = this->m_probeInterval;
+    }
+    else
+        this->m_probeTimer.start(this->m_probeDelay);
+    emit this->onlineChanged(online);
+    if (online)
+        this->dispatch();
+}
+// ---
+
+// Log
+QByteArray	MXOfflineQueue::record(RecordType type, quint64 id)
+{
+    QByteArray	block;
+    QDataStream	blockStream(&block, QIODevice::WriteOnly);
+
+    blockStream.setVersion(QDataStream::Qt_5_0);
+    blockStream << quint8(type) << id;
+    return (block);
+}
+
+bool	MXOfflineQueue::open(void)
+{
+    if (this->m_file.isOpen())
+        return (true);
+    if (!this->m_file.open(QIODevice::ReadWrite))
+        return (false);
+
+    QDataStream	stream(&this->m_file);
+    quint32		magic;
+    quint32		version;
+    qint64		valid = HEADER_SIZE;
+
+    this->m_pending = 0;
+    this->m_answered = 0;
+    this->m_lastId = 0;
+    this->m_watermark = 0;
+    this->m_acked.clear();
+    stream.setVersion(QDataStream::Qt_5_0);
+    if (this->m_file.size() == 0)
+        stream << quint32(MXOFFLINEQUEUE_MAGIC) << quint32(MXOFFLINEQUEUE_VERSION);
+    else
+    {
+        stream >> magic >> version;
+        if (magic != MXOFFLINEQUEUE_MAGIC || version != MXOFFLINEQUEUE_VERSION)
+        {
+            this->m_file.close();
+            return (false);
+        }
+
+        // Only ids and counts are kept from the previous sessions
+        while (!stream.atEnd())
+        {
+            QByteArray	block;
+            quint8		type;
+            quint64		id;
+
+            stream >> block;
+            if (stream.status() != QDataStream::Ok)
+                break;
+
+            QDataStream	blockStream(block);
+
+            blockStream.setVersion(QDataStream::Qt_5_0);
+            blockStream >> type >> id;
+            if (blockStream.status() != QDataStream::Ok)
+                break;
+            if (type == Request)
+                ++this->m_pending;
+            else if (type == Ack)
+                this->acknowledge(id);
+            else if (type == Checkpoint)
+                this->m_watermark = qMax(this->m_watermark, id);
+            this->m_lastId = qMax(this->m_lastId, id);
+            valid = this->m_file.pos();
+        }
+
+        // A record cut by a crash would hide the ones appended after it
+        if (valid < this->m_file.size())
+            this->m_file.resize(valid);
+    }
+
+    // Tried again right away, even if the last session ended offline
+    this->m_cursor = HEADER_SIZE;
+    this->m_probeDelay = this->m_probeInterval;
+    this->maybeCompact();
+    if (this->m_online)
+        this->dispatch();
+    else
+        this->setOnline(true);
+    return (true);
+}
+
+void	MXOfflineQueue::close(void)
+{
+    this->m_probeTimer.stop();
+    qDeleteAll(this->m_inFlight.keys());
+    this->m_inFlight.clear();
+    delete this->m_probe;
+    this->m_probe = NULL;
+    if (this->m_file.isOpen())
+    {
+        this->m_file.flush();
+        this->m_file.close();
+    }
+}
+
+bool	MXOfflineQueue::append(QByteArray const& block)
+{
+    QDataStream	stream(&this->m_file);
+
+    stream.setVersion(QDataStream::Qt_5_0);
+    if (!this->m_file.seek(this->m_file.size()))
+        return (false);
+    stream << block;
+    return (stream.status() == QDataStream::Ok && this->m_file.flush());
+}
+
+bool	MXOfflineQueue::readNext(Entry *entry)
+{
+    QDataStream	stream(&this->m_file);
+    QByteArray	block;
+    quint8		type;
+    bool		sending;
+
+    stream.setVersion(QDataStream::Qt_5_0);
+    if (!this->m_file.seek(this->m_cursor))
+        return (false);
+
+    while (!stream.atEnd())
+    {
+        entry->offset = this->m_file.pos();
+        stream >> block;
+        if (stream.status() != QDataStream::Ok)
+            return (false);
+        this->m_cursor = this->m_file.pos();
+
+        QDataStream	blockStream(block);
+
+        blockStream.setVersion(QDataStream::Qt_5_0);
+        blockStream >> type >> entry->id;
+        if (type != Request || this->isAcknowledged(entry->id))
+            continue;
+
+        // Met again after a rewind, while still being sent
+        sending = false;
+        foreach (Entry const& inFlight, this->m_inFlight)
+            sending = sending || inFlight.id == entry->id;
+        if (sending)
+            continue;
+
+        blockStream >> entry->queuedAt >> entry->method >> entry->resource
+                    >> entry->headers >> entry->body;
+        if (blockStream.status() == QDataStream::Ok)
+            return (true);
+    }
+    return (false);
+}
+
+void	MXOfflineQueue::acknowledge(quint64 id)
+{
+    if (this->isAcknowledged(id))
+        return;
+
+    --this->m_pending;
+    ++this->m_answered;
+    if (id != this->m_watermark + 1)
+    {
+        this->m_acked.insert(id);
+        return;
+    }
+    this->m_watermark = id;
+    while (this->m_acked.remove(this->m_watermark + 1))
+        ++this->m_watermark;
+}
+
+void	MXOfflineQueue::maybeCompact(void)
+{
+    if (this->m_answered > this->m_pending && this->m_file.size() >= this->m_compactionSize)
+        this->compact();
+}
+// ---
+
+// Treatments
+quint64	MXOfflineQueue::enqueue(QString const& resource, QString const& method,
+                                QByteArray const& body,
+                                MXRequestManager::MXEncodedPairList const& headers)
+{
+    QString		verb = method.toUpper();
+    QByteArray	block;
+    QDataStream	blockStream(&block, QIODevice::WriteOnly);
+
+    // Reads aren't worth replaying later
+    if (!this->m_file.isOpen() || resource.isEmpty() || verb.isEmpty()
+        || verb == "GET" || verb == "HEAD" || verb == "OPTIONS")
+        return (0);
+
+    blockStream.setVersion(QDataStream::Qt_5_0);
+    blockStream << quint8(Request) << quint64(this->m_lastId + 1)
+                << QDateTime::currentMSecsSinceEpoch() << verb << resource << headers << body;
+    if (!this->append(block))
+        return (0);
+
+    ++this->m_pending;
+    ++this->m_lastId;
+    this->dispatch();
+    return (this->m_lastId);
+}
+
+quint64	MXOfflineQueue::enqueue(QString const& resource, QString const& method,
+                                QJsonObject const& data)
+{
+    MXRequestManager::MXEncodedPairList	headers;
+
+    headers.append(MXRequestManager::MXEncodedPair("Content-Type", "application/json"));
+    return (this->enqueue(resource, method, MXRequestManager::toJsonBody(data), headers));
+}
+
+bool	MXOfflineQueue::compact(void)
+{
+    if (!this->m_file.isOpen())
+        return (false);
+
+    QSaveFile				out(this->m_file.fileName());
+    QDataStream				outStream(&out);
+    QDataStream				in(&this->m_file);
+    QByteArray				block;
+    quint8					type;
+    quint64					id;
+    QHash<quint64, qint64>	offsets;	// Of the requests kept, in the new log
+
+    if (!out.open(QIODevice::WriteOnly) || !this->m_file.seek(HEADER_SIZE))
+        return (false);
+    outStream.setVersion(QDataStream::Qt_5_0);
+    in.setVersion(QDataStream::Qt_5_0);
+    outStream << quint32(MXOFFLINEQUEUE_MAGIC) << quint32(MXOFFLINEQUEUE_VERSION)
+              << record(Checkpoint, this->m_watermark);
+
+    // Answered out of order requests are kept with their Ack: few of them
+    while (!in.atEnd())
+    {
+        in >> block;
+        if (in.status() != QDataStream::Ok)
+            break;
+
+        QDataStream	blockStream(block);
+
+        blockStream.setVersion(QDataStream::Qt_5_0);
+        blockStream >> type >> id;
+        if (type == Request && id > this->m_watermark)
+        {
+            offsets.insert(id, out.pos());
+            outStream << block;
+        }
+    }
+    foreach (id, this->m_acked)
+        outStream << record(Ack, id);
+    if (outStream.status() != QDataStream::Ok)
+    {
+        out.cancelWriting();
+        return (false);
+    }
+
+    this->m_file.close();
+    if (!out.commit())
+    {
+        this->m_file.open(QIODevice::ReadWrite);
+        return (false);
+    }
+    // Requests being sent are unanswered, so kept: only their offset moved
+    for (QHash<Watcher*, Entry>::iterator it = this->m_inFlight.begin();
+         it != this->m_inFlight.end(); ++it)
+        it.value().offset = offsets.value(it.value().id, HEADER_SIZE);
+    this->m_cursor = HEADER_SIZE; // Skips what is answered or being sent
+    this->m_answered = this->m_acked.size();
+    return (this->m_file.open(QIODevice::ReadWrite));
+}
+// ---
+
+// Slots
+void	MXOfflineQueue::flush(void)
+{
+    if (this->m_online)
+        this->dispatch();
+    else
+    {
+        this->m_probeTimer.stop();
+        this->probe();
+    }
+}
+
+void	MXOfflineQueue::dispatch(void)
+{
+    QFuture<MXRequestManager::Response>	future;
+    Entry								entry;
+    Watcher								*watcher;
+    int									i;
+
+    if (!this->m_online || this->m_manager.isNull() || !this->m_file.isOpen())
+        return;
+
+    while (this->m_inFlight.size() < this->m_concurrency && this->readNext(&entry))
+    {
+        i = -1;
+        while (++i < entry.headers.size())
+            this->m_manager->setRequestHeader(entry.headers.at(i).first,
+                                              entry.headers.at(i).second);
+
+        watcher = new Watcher(this);
+        connect(watcher, SIGNAL(finished()), SLOT(replyFinished()));
+        future = this->m_manager->requestAsync(entry.resource, entry.method, entry.body);
+        entry.body.clear(); // Read back from the log if sent again
+        this->m_inFlight.insert(watcher, entry);
+        watcher->setFuture(future);
+    }
+}
+
+void	MXOfflineQueue::replyFinished(void)
+{
+    Watcher						*watcher = static_cast<Watcher*>(this->sender());
+    Entry						entry = this->m_inFlight.take(watcher);
+    MXRequestManager::Response	response;
+
+    if (watcher->future().resultCount() > 0)
+        response = watcher->result();
+    watcher->deleteLater();
+    if (!this->m_file.isOpen())
+        return;
+
+    if (response.httpCode == 0 || response.httpCode == 408 || response.httpCode == 429
+        || response.httpCode >= 500)
+    {
+        // Sent again once the probe is answered, before the requests after it
+        this->m_cursor = qMin(this->m_cursor, entry.offset);
+        this->setOnline(false);
+        return;
+    }
+
+    this->append(record(Ack, entry.id)); // If lost, only sent again
+    this->acknowledge(entry.id);
+    if (response.httpCode >= 400)
+        emit this->rejected(entry.id, response.httpCode);
+    else
+        emit this->delivered(entry.id, response.httpCode);
+    if (this->m_pending == 0)
+        emit this->drained();
+
+    this->maybeCompact();
+    this->dispatch();
+}
+
+void	MXOfflineQueue::probe(void)
+{
+    if (this->m_manager.isNull() || this->m_probe != NULL || !this->m_file.isOpen())
+        return;
+
+    this->m_probe = new Watcher(this);
+    connect(this->m_probe, SIGNAL(finished()), SLOT(probeFinished()));
+    this->m_manager->setRequestTimeout(this->m_probeInterval); // Hung counts as unreachable
+    this->m_probe->setFuture(this->m_manager->requestAsync(this->m_probeResource,
+                                                           this->m_probeMethod));
+}
+
+void	MXOfflineQueue::probeFinished(void)
+{
+    MXRequestManager::Response	response;
+
+    if (this->m_probe->future().resultCount() > 0)
+        response = this->m_probe->result();
+    this->m_probe->deleteLater();
+    this->m_probe = NULL;
+
+    if (response.httpCode > 0 && response.httpCode < 500)
+        this->setOnline(true);
+    else
+    {
+        this->m_probeDelay = qMin(this->m_probeDelay * 2, MXOFFLINEQUEUE_MAX_PROBE);
+        this->m_probeTimer.start(this->m_probeDelay);
+    }
+}
+// ---
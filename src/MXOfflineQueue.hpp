@@ -0,0 +1,321 @@
+/**
+ * @brief		MXOfflineQueue
+ *
+ * @details		Durable outbound queue, replayed once the API is reachable
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXOFFLINEQUEUE_HPP
+# define	MXOFFLINEQUEUE_HPP
+
+# include	<QByteArray>
+# include	<QFile>
+# include	<QFutureWatcher>
+# include	<QHash>
+# include	<QJsonObject>
+# include	<QObject>
+# include	<QPointer>
+# include	<QSet>
+# include	<QString>
+# include	<QTimer>
+
+# include	"MXRequestManager.hpp"
+
+# define	MXOFFLINEQUEUE_MAGIC		0x4d584f51 // "MXOQ"
+# define	MXOFFLINEQUEUE_VERSION		1
+# define	MXOFFLINEQUEUE_MAX_PROBE	60000	// ms, longest delay between two probes
+
+/**
+ * @class	MXOfflineQueue
+ * @brief	Keeps mutating requests on disk until the API has answered them
+ * @extends	QObject
+ *
+ * Every enqueued request is appended to a log file before being sent, and
+ * an acknowledgement is appended once the server answered it. Requests
+ * still unanswered when the process stops are sent by the next one.
+ *
+ * When a request fails without an HTTP answer (or with 408, 429 or 5xx), the
+ * queue goes offline: requests are only logged, and a probe request is sent
+ * with an exponential backoff. Once it is answered, the log is flushed in
+ * order, at most concurrency() requests at a time (1 for a strict order).
+ * Other HTTP errors are final: the request is acknowledged and rejected().
+ *
+ * Only the requests being sent are held in memory, the others are read back
+ * from the log, so an outage of any length costs disk space only. The log is
+ * compacted once answered requests take most of it.
+ *
+ * Delivery is at least once: a request answered right before a crash, but
+ * not acknowledged yet, is sent again.
+ */
+
+class MXOfflineQueue : public QObject
+{
+    Q_OBJECT
+
+    private:
+        typedef QFutureWatcher<MXRequestManager::Response>	Watcher;
+
+        /**
+        * @enum
+        * Kind of a log record
+        */
+        enum RecordType
+        {
+            Request = 1,
+            Ack,			// The request with this id was answered
+            Checkpoint		// Every id up to this one was answered (compaction)
+        };
+
+        /**
+        * @struct
+        * Request read back from the log
+        */
+        struct Entry
+        {
+            quint64								id;
+            qint64								offset;		// Of its record in the log
+            qint64								queuedAt;	// ms since epoch
+            QString								method;
+            QString								resource;
+            MXRequestManager::MXEncodedPairList	headers;
+            QByteArray							body;
+        };
+
+        int							m_concurrency;
+        int							m_probeInterval;
+        int							m_probeDelay;		// Current backoff
+        qint64						m_compactionSize;
+        QString						m_probeResource;
+        QString						m_probeMethod;
+        bool						m_online;
+        int							m_pending;
+        int							m_answered;			// Since the last compaction
+        quint64						m_lastId;
+        quint64						m_watermark;		// Every id up to it was answered
+        QSet<quint64>				m_acked;			// Answered above the watermark
+        qint64						m_cursor;			// Next record to send
+        QFile						m_file;
+        QPointer<MXRequestManager>	m_manager;
+        QHash<Watcher*, Entry>		m_inFlight;			// Without their body
+        Watcher						*m_probe;
+        QTimer						m_probeTimer;
+
+        /**
+         * Encodes an Ack or Checkpoint record.
+         */
+        static QByteArray	record(RecordType type, quint64 id);
+
+        /**
+         * Appends a record to the log and flushes it.
+         *
+         * @param[in]	block	Encoded record
+         * @return		bool	FALSE if it couldn't be written
+         */
+        bool	append(QByteArray const& block);
+
+        /**
+         * Reads the next request to send, from the cursor.
+         *
+         * @param[out]	entry	Request read
+         * @return		bool	FALSE if there's none
+         */
+        bool	readNext(Entry *entry);
+
+        /**
+         * Marks a request as answered, in memory.
+         *
+         * @param[in]	id		Request id
+         * @return		void
+         */
+        void	acknowledge(quint64 id);
+
+        /**
+         * Tells whether a request was answered.
+         */
+        bool	isAcknowledged(quint64 id) const;
+
+        /**
+         * Changes the connectivity state, flushing or probing.
+         */
+        void	setOnline(bool online);
+
+        /**
+         * Compacts the log if answered requests take most of it.
+         */
+        void	maybeCompact(void);
+
+    public:
+        /**
+         * Constructs a queue logging to the given file.
+         * Nothing is logged or sent until open() succeeds.
+         *
+         * @param[in]	manager		Manager used to send the requests (not owned)
+         * @param[in]	fileName	Log file, created if needed
+         */
+        MXOfflineQueue(MXRequestManager *manager, QString const& fileName,
+                       QObject *parent = 0);
+
+        /**
+         * Closes the log. Unanswered requests stay in it.
+         */
+        ~MXOfflineQueue();
+
+        /**
+         * Opens the log and sends what a previous session left in it.
+         *
+         * @param		void
+         * @return		bool	FALSE if the file can't be opened or isn't a queue log
+         */
+        bool	open(void);
+
+        /**
+         * Closes the log. Requests being sent are forgotten, and sent again
+         * by the next open().
+         *
+         * @param		void
+         * @return		void
+         */
+        void	close(void);
+
+        /**
+         * Get the log state
+         *
+         * @param		void
+         * @return		bool	TRUE if the log is open
+         */
+        bool	isOpen(void) const;
+
+        /**
+         * Get the connectivity state
+         *
+         * @param		void
+         * @return		bool	FALSE while the API is considered unreachable
+         */
+        bool	isOnline(void) const;
+
+        /**
+         * Get the number of requests not answered yet
+         */
+        int		pending(void) const;
+
+        /**
+         * Set the number of requests sent at the same time (default 4).
+         */
+        void	setConcurrency(int max);
+
+        /**
+         * Get the number of requests sent at the same time
+         */
+        int		concurrency(void) const;
+
+        /**
+         * Set the request checking whether the API is reachable again.
+         * Any answer below 500 counts. Default: HEAD /, every 5 s at first.
+         *
+         * @param[in]	resource	Resource of the probe
+         * @param[in]	method		HTTP method of the probe
+         * @param[in]	interval	First delay between two probes (ms), doubled
+         *							after each failure, up to MAX_PROBE
+         * @return		void
+         */
+        void	setProbe(QString const& resource, QString const& method = "HEAD",
+                         int interval = 5000);
+
+        /**
+         * Set the log size from which it may be compacted (default 1 MiB).
+         */
+        void	setCompactionSize(qint64 bytes);
+
+        /**
+         * Logs a mutating request, and sends it if the API is reachable.
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		HTTP method, anything but GET, HEAD and OPTIONS
+         * @param[in]	body		Encoded body
+         * @param[in]	headers		Headers of this request (Content-Type, ...)
+         * @return		quint64		Id of the request, 0 if it couldn't be logged
+         */
+        quint64	enqueue(QString const& resource, QString const& method,
+                        QByteArray const& body = QByteArray(),
+                        MXRequestManager::MXEncodedPairList const& headers
+                        = MXRequestManager::MXEncodedPairList());
+
+        /**
+         * @overload
+         * Sends a JSON object, as application/json.
+         */
+        quint64	enqueue(QString const& resource, QString const& method,
+                        QJsonObject const& data);
+
+    public slots:
+        /**
+         * Sends the unanswered requests now if online, probes now otherwise.
+         */
+        void	flush(void);
+
+        /**
+         * Rewrites the log without the answered requests.
+         * Requests being sent are kept, and acknowledged in the new log.
+         *
+         * @param		void
+         * @return		bool	FALSE if not done
+         */
+        bool	compact(void);
+
+    private slots:
+        /**
+         * Sends the next requests of the log, up to the concurrency.
+         */
+        void	dispatch(void);
+
+        /**
+         * Called when a logged request is answered or failed.
+         */
+        void	replyFinished(void);
+
+        /**
+         * Sends the probe request.
+         */
+        void	probe(void);
+
+        /**
+         * Called when the probe request is answered or failed.
+         */
+        void	probeFinished(void);
+
+    signals:
+        /**
+         * Emitted when a request was answered with an HTTP code below 400
+         */
+        void	delivered(quint64 id, int httpCode);
+
+        /**
+         * Emitted when a request was refused for good (HTTP 4xx but 408 and 429).
+         * It is removed from the queue.
+         */
+        void	rejected(quint64 id, int httpCode);
+
+        /**
+         * Emitted when the API becomes unreachable, or reachable again
+         */
+        void	onlineChanged(bool online);
+
+        /**
+         * Emitted when the last pending request was answered
+         */
+        void	drained(void);
+};
+
+#endif // MXOFFLINEQUEUE_HPP
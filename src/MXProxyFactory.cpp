@@ -0,0 +1,185 @@
+/**
+ * @file		MXProxyFactory.cpp
+ * @brief		MXProxyFactory
+ *
+ * @details		Process-wide proxy configuration, with decisions cached per host
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "MXProxyFactory.hpp"
+
+// Shared configuration
+namespace
+{
+    int const	MaxCachedHosts = 1024;
+
+    struct ProxyState
+    {
+        QMutex									mutex;
+        MXProxyFactory::Mode					mode;
+        QNetworkProxy							proxy;
+        QStringList								noProxy;
+        QHash<QString, QList<QNetworkProxy> >	cache;
+
+        ProxyState(void) : mode(MXProxyFactory::ApplicationProxy) {}
+    };
+
+    ProxyState	&state(void)
+    {
+        static ProxyState	instance;
+
+        return (instance);
+    }
+}
+// ---
+
+// Getters / Setters
+MXProxyFactory::Mode	MXProxyFactory::mode(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().mode);
+}
+
+void	MXProxyFactory::setApplicationProxy(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().mode = ApplicationProxy;
+    state().cache.clear();
+}
+
+void	MXProxyFactory::setSystemProxy(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().mode = SystemProxy;
+    state().cache.clear();
+}
+
+void	MXProxyFactory::setExplicitProxy(QNetworkProxy const& proxy)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().mode = ExplicitProxy;
+    state().proxy = proxy;
+    state().cache.clear();
+}
+
+QNetworkProxy	MXProxyFactory::explicitProxy(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().proxy);
+}
+
+void	MXProxyFactory::setNoProxy(QStringList const& hosts)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().noProxy = hosts;
+    state().cache.clear();
+}
+
+QStringList	MXProxyFactory::noProxy(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().noProxy);
+}
+
+void	MXProxyFactory::clearCache(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().cache.clear();
+}
+
+int		MXProxyFactory::cacheSize(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().cache.size());
+}
+// ---
+
+// Treatments
+bool	MXProxyFactory::bypassed(QStringList const& noProxy, QString const& host)
+{
+    int	i = -1;
+
+    while (++i < noProxy.size())
+    {
+        QString const&	entry = noProxy.at(i);
+
+        if (entry == "*" || host.compare(entry, Qt::CaseInsensitive) == 0)
+            return (true);
+        if (entry.startsWith('.') && (host.endsWith(entry, Qt::CaseInsensitive)
+                                      || host.compare(entry.mid(1), Qt::CaseInsensitive) == 0))
+            return (true);
+    }
+    return (false);
+}
+
+QList<QNetworkProxy>	MXProxyFactory::queryProxy(QNetworkProxyQuery const& query)
+{
+    QString					key(query.protocolTag() + "://" + query.peerHostName().toLower()
+                                + ':' + QString::number(query.peerPort()));
+    QList<QNetworkProxy>	proxies;
+    Mode					mode;
+    QNetworkProxy			proxy;
+    QStringList				noProxy;
+
+    {
+        QMutexLocker	lock(&state().mutex);
+
+        if (state().cache.contains(key))
+            return (state().cache.value(key));
+        mode = state().mode;
+        proxy = state().proxy;
+        noProxy = state().noProxy;
+    }
+
+    // Resolved unlocked: the system lookup may be slow (PAC, WPAD)
+    if (bypassed(noProxy, query.peerHostName()))
+        proxies << QNetworkProxy(QNetworkProxy::NoProxy);
+    else if (mode == ExplicitProxy)
+        proxies << proxy;
+    else if (mode == SystemProxy)
+        proxies = QNetworkProxyFactory::systemProxyForQuery(query);
+    else
+        proxies = QNetworkProxyFactory::proxyForQuery(query);
+    if (proxies.isEmpty())
+        proxies << QNetworkProxy(QNetworkProxy::NoProxy);
+
+    {
+        QMutexLocker	lock(&state().mutex);
+
+        // Dropped if the configuration changed meanwhile
+        if (mode != ApplicationProxy && state().mode == mode && state().proxy == proxy
+            && state().noProxy == noProxy)
+        {
+            if (state().cache.size() >= MaxCachedHosts)
+                state().cache.clear();
+            state().cache.insert(key, proxies);
+        }
+    }
+    return (proxies);
+}
+// ---
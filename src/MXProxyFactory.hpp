@@ -0,0 +1,121 @@
+/**
+ * @brief		MXProxyFactory
+ *
+ * @details		Process-wide proxy configuration, with decisions cached per host
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXPROXYFACTORY_HPP
+# define	MXPROXYFACTORY_HPP
+
+# include	<QList>
+# include	<QString>
+# include	<QStringList>
+# include	<QtNetwork/QNetworkProxy>
+
+/**
+ * @class	MXProxyFactory
+ * @brief	Resolves the proxy of each request from a shared configuration
+ * @extends	QNetworkProxyFactory
+ *
+ * Every transport created by MXRequestManager owns one of these. They all
+ * read the same process-wide configuration and share a cache of decisions,
+ * keyed by scheme, host and port: the system lookup or the no-proxy matching
+ * is done once per host, not for every request or every manager.
+ * Changing the configuration clears the cache. Nothing is cached in
+ * ApplicationProxy mode: QNetworkProxy::setApplicationProxy() doesn't tell us.
+ */
+
+class MXProxyFactory : public QNetworkProxyFactory
+{
+    public:
+        /**
+        * @enum
+        */
+        enum Mode
+        {
+            ApplicationProxy = 0,	// Default: what QNetworkProxy::applicationProxy() says
+            SystemProxy,			// Platform settings (environment, PAC, ...)
+            ExplicitProxy			// The proxy given to setExplicitProxy()
+        };
+
+        /**
+         * Get the mode used to resolve the proxies
+         */
+        static Mode				mode(void);
+
+        /**
+         * Resolve the proxies with Qt's application-wide settings (default).
+         */
+        static void				setApplicationProxy(void);
+
+        /**
+         * Resolve the proxies with the platform settings.
+         */
+        static void				setSystemProxy(void);
+
+        /**
+         * Send every request through the given proxy, except the no-proxy hosts.
+         *
+         * @param[in]	proxy	Proxy to use
+         * @return		void
+         */
+        static void				setExplicitProxy(QNetworkProxy const& proxy);
+
+        /**
+         * Get the proxy given to setExplicitProxy()
+         */
+        static QNetworkProxy	explicitProxy(void);
+
+        /**
+         * Set the hosts reached without proxy, whatever the mode.
+         * An entry matches a host exactly, ".example.com" matches its
+         * subdomains and "*" matches every host. Matching is case-insensitive.
+         *
+         * @param[in]	hosts	No-proxy list
+         * @return		void
+         */
+        static void				setNoProxy(QStringList const& hosts);
+
+        /**
+         * Get the no-proxy list
+         */
+        static QStringList		noProxy(void);
+
+        /**
+         * Forget every cached decision (e.g. after a network change).
+         */
+        static void				clearCache(void);
+
+        /**
+         * Get the number of cached decisions
+         */
+        static int				cacheSize(void);
+
+        /**
+         * Returns the proxies for a query, from the cache when possible
+         * (never in ApplicationProxy mode).
+         *
+         * @param[in]	query	Proxy query
+         * @return		QList	Proxies to try, in order
+         */
+        QList<QNetworkProxy>	queryProxy(QNetworkProxyQuery const& query = QNetworkProxyQuery())
+                                    override;
+
+    private:
+        static bool				bypassed(QStringList const& noProxy, QString const& host);
+};
+
+#endif // MXPROXYFACTORY_HPP
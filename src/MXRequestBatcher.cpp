@@ -0,0 +1,185 @@
+/**
+ * @file		MXRequestBatcher.cpp
+ * @brief		MXRequestBatcher
+ *
+ * @details		Write-behind batching of small requests into bulk calls
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "MXRequestBatcher.hpp"
+
+// Constructors
+MXRequestBatcher::MXRequestBatcher(MXRequestManager *manager, QString const& resource,
+                                   QObject *parent)
+    : QObject(parent), m_maxCount(100), m_maxBytes(64 * 1024), m_maxDelay(1000),
+      m_format(JsonArray), m_resource(resource), m_method("POST"), m_manager(manager)
+{
+    this->m_timer.setSingleShot(true);
+    connect(&this->m_timer, SIGNAL(timeout()), SLOT(flush()));
+}
+
+MXRequestBatcher::~MXRequestBatcher()
+{
+    QHashIterator<Watcher*, Callers>	i(this->m_inFlight);
+    MXRequestManager::Response			canceled;
+    Callers								callers = this->m_callers;
+    int									j = -1;
+
+    canceled.error = QNetworkReply::OperationCanceledError;
+    canceled.errorString = "Batcher destroyed";
+    canceled.interruption = MXRequestManager::Canceled;
+    while (i.hasNext())
+    {
+        i.next();
+        callers.append(i.value());
+    }
+    while (++j < callers.size())
+    {
+        callers[j].reportResult(canceled);
+        callers[j].reportFinished();
+    }
+}
+// ---
+
+// Getters / Setters
+void	MXRequestBatcher::setThresholds(int maxCount, int maxBytes, int maxDelay)
+{
+    this->m_maxCount = maxCount;
+    this->m_maxBytes = maxBytes;
+    this->m_maxDelay = maxDelay;
+}
+
+void	MXRequestBatcher::setFormat(BodyFormat format)
+{
+    this->m_format = format;
+}
+
+void	MXRequestBatcher::setMethod(QString const& method)
+{
+    this->m_method = method;
+}
+
+int		MXRequestBatcher::pending(void) const
+{
+    return (this->m_callers.size());
+}
+// ---
+
+// Treatments
+QFuture<MXRequestManager::Response>	MXRequestBatcher::enqueue(MXRequestManager::MXMap const& data)
+{
+    MXRequestManager::MXMapIterator	i(data);
+    QJsonObject						object;
+
+    while (i.hasNext())
+    {
+        i.next();
+        object.insert(i.key(), i.value());
+    }
+    return (this->enqueue(object));
+}
+
+QFuture<MXRequestManager::Response>	MXRequestBatcher::enqueue(QJsonObject const& data)
+{
+    QFutureInterface<MXRequestManager::Response>	caller;
+
+    caller.reportStarted();
+    if (this->m_callers.isEmpty())
+        this->m_oldest.start();
+    else
+        this->m_body.append(this->m_format == Ndjson ? '\n' : ',');
+    this->m_body.append(MXRequestManager::toJsonBody(data));
+    this->m_callers.append(caller);
+
+    if ((this->m_maxCount > 0 && this->m_callers.size() >= this->m_maxCount)
+        || (this->m_maxBytes > 0 && this->m_body.size() >= this->m_maxBytes))
+        this->flush();
+    else if (!this->m_timer.isActive()) // Without maxDelay, at the next event loop pass
+        this->m_timer.start(qMax(0, this->m_maxDelay));
+    return (caller.future());
+}
+
+void	MXRequestBatcher::flush(void)
+{
+    QFuture<MXRequestManager::Response>	future;
+    QByteArray							body;
+    Callers								callers;
+    Watcher								*watcher;
+
+    this->m_timer.stop();
+    if (this->m_callers.isEmpty())
+        return;
+
+    callers = this->m_callers;
+    body = this->m_body;
+    this->m_callers.clear();
+    this->m_body.clear();
+    if (this->m_format == Ndjson)
+        body.append('\n');
+    else
+        body.prepend('[').append(']');
+
+    if (this->m_manager.isNull())
+        future = QFuture<MXRequestManager::Response>();
+    else
+    {
+        this->m_manager->setRequestHeader("Content-Type", this->m_format == Ndjson
+                                                          ? "application/x-ndjson"
+                                                          : "application/json");
+        if (this->m_manager->timeout() > 0)
+            this->m_manager->setRequestTimeout(qMax(1, this->m_manager->timeout()
+                                                       - int(this->m_oldest.elapsed())));
+        future = this->m_manager->requestAsync(this->m_resource, this->m_method, body);
+    }
+
+    watcher = new Watcher(this);
+    this->m_inFlight.insert(watcher, callers);
+    connect(watcher, SIGNAL(finished()), SLOT(bulkFinished()));
+    watcher->setFuture(future);
+}
+
+void	MXRequestBatcher::bulkFinished(void)
+{
+    Watcher						*watcher = static_cast<Watcher*>(this->sender());
+    Callers						callers = this->m_inFlight.take(watcher);
+    MXRequestManager::Response	bulk;
+    QJsonArray					items;
+    int							i = -1;
+
+    if (watcher->future().resultCount() > 0)
+        bulk = watcher->result();
+    watcher->deleteLater();
+
+    if (bulk.error == QNetworkReply::NoError && !bulk.rawData.isEmpty())
+        items = QJsonDocument::fromJson(bulk.rawData).array();
+
+    while (++i < callers.size())
+    {
+        MXRequestManager::Response	response = bulk;
+
+        if (items.size() == callers.size())
+        {
+            response.rawData = MXRequestManager::toJsonBody(items.at(i));
+            response.data = items.at(i).toObject().toVariantMap();
+            response.ok = bulk.ok;
+        }
+        callers[i].reportResult(response);
+        callers[i].reportFinished();
+    }
+}
+// ---
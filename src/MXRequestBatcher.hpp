@@ -0,0 +1,154 @@
+/**
+ * @brief		MXRequestBatcher
+ *
+ * @details		Write-behind batching of small requests into bulk calls
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXREQUESTBATCHER_HPP
+# define	MXREQUESTBATCHER_HPP
+
+# include	<QByteArray>
+# include	<QElapsedTimer>
+# include	<QFutureInterface>
+# include	<QFutureWatcher>
+# include	<QHash>
+# include	<QJsonObject>
+# include	<QList>
+# include	<QObject>
+# include	<QPointer>
+# include	<QString>
+# include	<QTimer>
+
+# include	"MXRequestManager.hpp"
+
+/**
+ * @class	MXRequestBatcher
+ * @brief	Buffers small requests to a resource and sends them in bulk
+ * @extends	QObject
+ *
+ * Each enqueued item is encoded once, as compact JSON. The buffer is flushed
+ * as a single request when it holds maxCount items or maxBytes bytes, or
+ * maxDelay ms after its first item, whichever comes first.
+ *
+ * If the bulk response is a JSON array with one element per item, each caller
+ * gets its own element (in rawData, and in data when it's an object).
+ * Otherwise every caller gets the bulk response.
+ *
+ * Items count the timeout() of the manager from the time they are buffered:
+ * a bulk request only gets what is left of the timeout of its oldest item.
+ */
+
+class MXRequestBatcher : public QObject
+{
+    Q_OBJECT
+
+    public:
+        /**
+        * @enum
+        */
+        enum BodyFormat
+        {
+            JsonArray = 0,	// Default: [item,item,...]
+            Ndjson			// item\nitem\n...
+        };
+
+    private:
+        typedef QFutureWatcher<MXRequestManager::Response>	Watcher;
+        typedef QList<QFutureInterface<MXRequestManager::Response> >	Callers;
+
+        int							m_maxCount;
+        int							m_maxBytes;
+        int							m_maxDelay;
+        BodyFormat					m_format;
+        QString						m_resource;
+        QString						m_method;
+        QPointer<MXRequestManager>	m_manager;
+        QByteArray					m_body;
+        Callers						m_callers;
+        QHash<Watcher*, Callers>	m_inFlight;
+        QTimer						m_timer;
+        QElapsedTimer				m_oldest;	// Since the first buffered item
+
+    public:
+        /**
+         * Constructs a batcher sending to the given resource of a manager.
+         *
+         * @param[in]	manager		Manager used to send the bulk requests (not owned)
+         * @param[in]	resource	Bulk resource, e.g. "/events/bulk"
+         */
+        MXRequestBatcher(MXRequestManager *manager, QString const& resource,
+                         QObject *parent = 0);
+
+        /**
+         * Resolves the buffered and in flight items with the Canceled
+         * interruption: their bulk response would have nobody to dispatch it.
+         */
+        ~MXRequestBatcher();
+
+        /**
+         * Set the flush thresholds. 0 disables a threshold.
+         * Defaults: 100 items, 64 KiB, 1000 ms.
+         *
+         * @param[in]	maxCount	Items per bulk request
+         * @param[in]	maxBytes	Body size per bulk request
+         * @param[in]	maxDelay	Time an item may wait in the buffer (ms)
+         * @return		void
+         */
+        void	setThresholds(int maxCount, int maxBytes, int maxDelay);
+
+        /**
+         * Set the body format (default JsonArray).
+         */
+        void	setFormat(BodyFormat format);
+
+        /**
+         * Set the HTTP method of the bulk requests (default POST).
+         */
+        void	setMethod(QString const& method);
+
+        /**
+         * Get the number of buffered items
+         */
+        int		pending(void) const;
+
+        /**
+         * Buffers an item.
+         *
+         * @param[in]	data		Item, sent as a JSON object of strings
+         * @return		QFuture		Resolved when the bulk request holding it is answered
+         */
+        QFuture<MXRequestManager::Response>	enqueue(MXRequestManager::MXMap const& data);
+
+        /**
+         * @overload
+         * @param[in]	data		Item, sent as is
+         */
+        QFuture<MXRequestManager::Response>	enqueue(QJsonObject const& data);
+
+    public slots:
+        /**
+         * Sends the buffered items now, if any.
+         */
+        void	flush(void);
+
+    private slots:
+        /**
+         * Dispatches a bulk response to the callers of its items.
+         */
+        void	bulkFinished(void);
+};
+
+#endif // MXREQUESTBATCHER_HPP
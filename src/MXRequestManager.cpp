@@ -18,92 +18,229 @@
  * San Francisco, California 94105, USA" so we can mail you a copy immediately.
  */
 
+#include <QBuffer>
+#include <QLoggingCategory>
+#include <QMetaProperty>
+#include <QTimer>
+
+#include <climits>
+
+#include "MXEndpointPool.hpp"
+#include "MXJsonPointer.hpp"
+#include "MXMultiPartBody.hpp"
+#include "MXProxyFactory.hpp"
 #include "MXRequestManager.hpp"
+#include "MXRequestMetrics.hpp"
+#include "MXRequestRecorder.hpp"
+#include "MXSessionCache.hpp"
+
+// Diagnostics are off unless enabled, e.g. QT_LOGGING_RULES="mxrequest.debug=true"
+Q_LOGGING_CATEGORY(lcMXRequest, "mxrequest", QtWarningMsg)
 
-MXRequestManager::MXRequestManager(QObject *parent) : QNetworkAccessManager(parent), m_lastHttpCode(0)
+#define	HEDGE_MIN_SAMPLES	20	// Latencies needed before hedging
+
+MXRequestManager::MXRequestManager(QObject *parent)
+    : QNetworkAccessManager(parent), m_httpAuthCount(0), m_lastHttpCode(0),
+      m_config(new Config), m_netNextEndpoint(-1),
+      m_netNextTimeout(-1), m_netNextIdleTimeout(-1), m_lastInterruption(NotInterrupted)
 {
-    this->m_responseType = JSON;
-    this->m_netReply = NULL;
+    this->m_config->responseType = JSON;
+    this->m_config->transport = createTransport();
     this->m_netRequest = new QNetworkRequest;
     this->setUserAgent();
-
-    // Hack: Keychain access
-    this->m_netProxy = this->proxy();
-    this->m_netProxy.setHostName(" ");
-    this->setProxy(this->m_netProxy);
-    // ---
-
-    connect(this, SIGNAL(finished(QNetworkReply*)), SLOT(requestFinished(QNetworkReply*)));
-    connect(this, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
-            SLOT(requestAuth(QNetworkReply*,QAuthenticator*)));
+    this->init();
 }
 
 MXRequestManager::MXRequestManager(QUrl apiUrl, QString authUser,
                                    QString authPass, QObject *parent)
-    : QNetworkAccessManager(parent), m_lastHttpCode(0)
+    : QNetworkAccessManager(parent), m_httpAuthCount(0), m_lastHttpCode(0),
+      m_config(new Config), m_netNextEndpoint(-1),
+      m_netNextTimeout(-1), m_netNextIdleTimeout(-1), m_lastInterruption(NotInterrupted)
 {
-    this->m_responseType = JSON;
-    this->m_netReply = NULL;
-    this->m_netBaseApiUrl = apiUrl;
+    this->m_config->responseType = JSON;
+    this->m_config->baseApiUrl = apiUrl;
     if (!authUser.isEmpty() || !authPass.isEmpty())
     {
-        this->m_netAuthUser = authUser;
-        this->m_netAuthPass = authPass;
+        this->m_config->authUser = authUser;
+        this->m_config->authPass = authPass;
     }
+    this->m_config->transport = createTransport();
     this->m_netRequest = new QNetworkRequest;
     this->setUserAgent();
-
-    // Hack: Keychain access
-    this->m_netProxy = this->proxy();
-    this->m_netProxy.setHostName(" ");
-    this->setProxy(this->m_netProxy);
-    // ---
-
-    connect(this, SIGNAL(finished(QNetworkReply*)), SLOT(requestFinished(QNetworkReply*)));
-    connect(this, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
-            SLOT(requestAuth(QNetworkReply*,QAuthenticator*)));
+    this->init();
 }
 
 MXRequestManager::MXRequestManager(MXRequestManager const& other)
-    : QNetworkAccessManager(other.parent()), m_lastHttpCode(0)
+    : QNetworkAccessManager(other.parent()), m_httpAuthCount(0), m_lastHttpCode(0),
+      m_config(other.m_config), m_netNextEndpoint(-1),
+      m_netNextTimeout(-1), m_netNextIdleTimeout(-1), m_lastInterruption(NotInterrupted)
 {
-    this->m_responseType = other.m_responseType;
     this->m_netDataRaw = other.m_netDataRaw;
-    this->m_netReply = other.m_netReply;
     this->m_netRequest = new QNetworkRequest(*(other.m_netRequest));
-    this->m_netAuthUser = other.m_netAuthUser;
-    this->m_netAuthPass = other.m_netAuthPass;
-    this->m_netBaseApiUrl = other.m_netBaseApiUrl;
-
-    // Hack: Keychain access
-    this->setProxy(other.m_netProxy);
-    // ---
+    this->m_recorder = other.m_recorder;
+    this->m_metrics = other.m_metrics;
+    this->init();
+}
 
-    connect(this, SIGNAL(finished(QNetworkReply*)), SLOT(requestFinished(QNetworkReply*)));
-    connect(this, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
-            SLOT(requestAuth(QNetworkReply*,QAuthenticator*)));
+MXRequestManager::MXRequestManager(MXRequestManager&& other)
+    : QNetworkAccessManager(other.parent()), m_httpAuthCount(0), m_lastHttpCode(0),
+      m_config(other.m_config), m_netNextEndpoint(-1),
+      m_netNextTimeout(-1), m_netNextIdleTimeout(-1), m_lastInterruption(NotInterrupted)
+{
+    this->m_netRequest = new QNetworkRequest;
+    this->init();
+    this->take(other);
 }
 
 MXRequestManager::~MXRequestManager()
 {
-    delete this->m_netReply;
-    this->m_netReply = NULL;
+    QMutableHashIterator<QNetworkReply*, QFutureInterface<Response> >	i(this->m_netFutures);
+    QNetworkReply														*reply;
+    Response															canceled;
+
+    canceled.error = QNetworkReply::OperationCanceledError;
+    canceled.errorString = "Manager destroyed";
+    canceled.interruption = Canceled;
+    while (i.hasNext())
+    {
+        i.next();
+        i.value().reportResult(canceled);
+        i.value().reportFinished();
+    }
+    this->m_netFutures.clear();
+
+    // The transport may outlive us: drop our replies now
+    foreach (reply, this->m_netReplies)
+        this->dropReply(reply, true);
+
     delete this->m_netRequest;
     this->m_netRequest = NULL;
 }
 // ---
 
+// Internals
+QSharedPointer<QNetworkAccessManager>	MXRequestManager::createTransport(void)
+{
+    QSharedPointer<QNetworkAccessManager>	transport(new QNetworkAccessManager,
+                                                      &QObject::deleteLater);
+
+    // Set once per transport, resolved from the shared configuration and cache
+    transport->setProxyFactory(new MXProxyFactory);
+    return (transport);
+}
+
+void	MXRequestManager::init(void)
+{
+    this->m_progressTimer.setSingleShot(true);
+    connect(&this->m_progressTimer, SIGNAL(timeout()), SLOT(progressTimeout()));
+    connect(this->m_config->transport.data(),
+            SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)),
+            SLOT(requestAuth(QNetworkReply*,QAuthenticator*)));
+}
+
+void	MXRequestManager::watchReply(QNetworkReply *reply)
+{
+    connect(reply, SIGNAL(finished()), SLOT(replyFinished()));
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)),
+            SLOT(requestDownloadProgress(qint64,qint64)));
+    connect(reply, SIGNAL(uploadProgress(qint64,qint64)),
+            SLOT(requestUploadProgress(qint64,qint64)));
+#ifndef	QT_NO_SSL
+    if (reply->url().scheme() == "https")
+        connect(reply, SIGNAL(encrypted()), SLOT(replyEncrypted()));
+#endif
+}
+
+void	MXRequestManager::take(MXRequestManager& other)
+{
+    QNetworkReply	*reply;
+
+    if (this->m_config->transport != other.m_config->transport)
+    {
+        this->m_config->transport->disconnect(this);
+        this->m_config = other.m_config;
+        this->init();
+    }
+    else
+        this->m_config = other.m_config;
+
+    this->m_lastHttpCode = other.m_lastHttpCode;
+    this->m_netDataRaw = other.m_netDataRaw;
+    this->m_netDataMap = other.m_netDataMap;
+    this->m_netReply = other.m_netReply;
+    *(this->m_netRequest) = *(other.m_netRequest);
+    this->m_recorder = other.m_recorder;
+    this->m_metrics = other.m_metrics;
+
+    foreach (reply, other.m_netReplies)
+    {
+        reply->disconnect(&other);
+        this->watchReply(reply);
+        this->m_netReplies.insert(reply);
+    }
+    this->m_netFutures.unite(other.m_netFutures);
+    this->m_netProgress.unite(other.m_netProgress);
+    this->m_netRoutes.unite(other.m_netRoutes);
+    this->m_netInterruptions.unite(other.m_netInterruptions);
+
+    QHashIterator<QNetworkReply*, Deadline>	deadline(other.m_netDeadlines);
+
+    while (deadline.hasNext())
+    {
+        deadline.next();
+        deadline.value().timer->disconnect(&other);
+        connect(deadline.value().timer, SIGNAL(timeout()), SLOT(deadlineExpired()));
+        this->m_netDeadlines.insert(deadline.key(), deadline.value());
+    }
+
+    if (other.m_progressTimer.isActive()) // Their pending progress is ours now
+    {
+        other.m_progressTimer.stop();
+        this->m_progressTimer.start(0);
+    }
+
+    other.m_netReplies.clear();
+    other.m_netFutures.clear();
+    other.m_netProgress.clear();
+    other.m_netRoutes.clear();
+    other.m_netDeadlines.clear();
+    other.m_netInterruptions.clear();
+    other.m_netDataRaw.clear();
+    other.m_netDataMap.clear();
+    other.m_netReply = NULL;
+}
+// ---
+
 // Operators Overloads
 MXRequestManager&	MXRequestManager::operator=(MXRequestManager const& other)
 {
+    if (this == &other)
+        return (*this);
+
     this->setParent(other.parent());
+    if (this->m_config->transport != other.m_config->transport)
+    {
+        this->m_config->transport->disconnect(this);
+        this->m_config = other.m_config;
+        this->init();
+    }
+    else
+        this->m_config = other.m_config;
     this->m_netDataRaw = other.m_netDataRaw;
-    this->m_netReply = other.m_netReply;
-    this->m_netRequest = other.m_netRequest;
-    this->m_netAuthUser = other.m_netAuthUser;
-    this->m_netAuthPass = other.m_netAuthPass;
-    this->m_netBaseApiUrl = other.m_netBaseApiUrl;
+    *(this->m_netRequest) = *(other.m_netRequest);
+    this->m_recorder = other.m_recorder;
+    this->m_metrics = other.m_metrics;
+
+    return (*this);
+}
 
+MXRequestManager&	MXRequestManager::operator=(MXRequestManager&& other)
+{
+    if (this == &other)
+        return (*this);
+
+    this->setParent(other.parent());
+    this->take(other);
     return (*this);
 }
 // ---
@@ -111,22 +248,27 @@ MXRequestManager&	MXRequestManager::operator=(MXRequestManager const& other)
 // Getters / Setters
 QString	MXRequestManager::authUser(void) const
 {
-    return (this->m_netAuthUser);
+    return (this->m_config->authUser);
 }
 
 QString	MXRequestManager::authPass(void) const
 {
-    return (this->m_netAuthPass);
+    return (this->m_config->authPass);
 }
 
 QUrl	MXRequestManager::apiUrl(void) const
 {
-    return (this->m_netBaseApiUrl);
+    return (this->m_config->baseApiUrl);
 }
 
 QString	MXRequestManager::userAgent(void) const
 {
-    return (this->m_netRequest->rawHeader("User-Agent"));
+    return (this->m_config->requestTemplate.rawHeader("User-Agent"));
+}
+
+MXRequestManager::MXEncodedMap const&	MXRequestManager::defaultHeaders(void) const
+{
+    return (this->m_config->defaultHeaders);
 }
 
 int     MXRequestManager::lastHttpCode(void) const
@@ -134,6 +276,11 @@ int     MXRequestManager::lastHttpCode(void) const
     return (this->m_lastHttpCode);
 }
 
+MXRequestManager::Interruption	MXRequestManager::lastInterruption(void) const
+{
+    return (this->m_lastInterruption);
+}
+
 QNetworkRequest const&  MXRequestManager::networkRequest(void)
 {
     return (*(this->m_netRequest));
@@ -144,6 +291,63 @@ QNetworkReply const&  MXRequestManager::networkReply(void)
     return (*(this->m_netReply));
 }
 
+QNetworkAccessManager	*MXRequestManager::transport(void) const
+{
+    return (this->m_config->transport.data());
+}
+
+void	MXRequestManager::setProxy(QNetworkProxy const& proxy)
+{
+    this->transport()->setProxy(proxy);
+}
+
+QNetworkProxy	MXRequestManager::proxy(void) const
+{
+    return (this->transport()->proxy());
+}
+
+void	MXRequestManager::setProxyFactory(QNetworkProxyFactory *factory)
+{
+    this->transport()->setProxyFactory(factory);
+}
+
+QNetworkProxyFactory	*MXRequestManager::proxyFactory(void) const
+{
+    return (this->transport()->proxyFactory());
+}
+
+void	MXRequestManager::setCookieJar(QNetworkCookieJar *cookieJar)
+{
+    this->transport()->setCookieJar(cookieJar);
+}
+
+QNetworkCookieJar	*MXRequestManager::cookieJar(void) const
+{
+    return (this->transport()->cookieJar());
+}
+
+void	MXRequestManager::setCache(QAbstractNetworkCache *cache)
+{
+    this->transport()->setCache(cache);
+}
+
+QAbstractNetworkCache	*MXRequestManager::cache(void) const
+{
+    return (this->transport()->cache());
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+void	MXRequestManager::setNetworkAccessible(NetworkAccessibility accessible)
+{
+    this->transport()->setNetworkAccessible(accessible);
+}
+
+QNetworkAccessManager::NetworkAccessibility	MXRequestManager::networkAccessible(void) const
+{
+    return (this->transport()->networkAccessible());
+}
+#endif
+
 QByteArray	const&	MXRequestManager::rawData(void) const
 {
     return (this->m_netDataRaw);
@@ -154,19 +358,61 @@ QVariantMap	const&	MXRequestManager::data(void) const
     return (this->m_netDataMap);
 }
 
+QVariant	MXRequestManager::rawValue(QString const& pointer, bool *found) const
+{
+    return (MXJsonPointer(pointer).value(this->m_netDataRaw, found));
+}
+
 void	MXRequestManager::setAuthUser(QString const& authUser)
 {
-    this->m_netAuthUser = authUser;
+    this->m_config.detach();
+    this->m_config->authUser = authUser;
 }
 
 void	MXRequestManager::setAuthPass(QString const& authPass)
 {
-    this->m_netAuthPass = authPass;
+    this->m_config.detach();
+    this->m_config->authPass = authPass;
 }
 
 void	MXRequestManager::setApiUrl(QUrl const& apiUrl)
 {
-    this->m_netBaseApiUrl = apiUrl;
+    this->m_config.detach();
+    this->m_config->baseApiUrl = apiUrl;
+    this->m_config->endpoints.clear();
+}
+
+QList<QUrl>	MXRequestManager::apiUrls(void) const
+{
+    if (this->m_config->endpoints.isNull())
+        return (QList<QUrl>() << this->m_config->baseApiUrl);
+    return (this->m_config->endpoints->urls());
+}
+
+void	MXRequestManager::setApiUrls(QList<QUrl> const& apiUrls)
+{
+    this->m_config.detach();
+    this->m_config->baseApiUrl = apiUrls.value(0);
+    if (apiUrls.size() > 1)
+        this->m_config->endpoints = QSharedPointer<MXEndpointPool>(new MXEndpointPool(apiUrls));
+    else
+        this->m_config->endpoints.clear();
+}
+
+MXEndpointPool	*MXRequestManager::endpointPool(void) const
+{
+    return (this->m_config->endpoints.data());
+}
+
+double	MXRequestManager::hedgePercentile(void) const
+{
+    return (this->m_config->hedgePercentile);
+}
+
+void	MXRequestManager::setHedgePercentile(double percentile)
+{
+    this->m_config.detach();
+    this->m_config->hedgePercentile = qBound(0.0, percentile, 100.0);
 }
 
 void	MXRequestManager::setUserAgent(QString const& userAgent)
@@ -180,12 +426,96 @@ void	MXRequestManager::setUserAgent(QString const& userAgent)
                 .append('/').append(MXREQUESTMANAGER_PLATEFORM);
     else
         ua.append(userAgent);
-    this->m_netRequest->setRawHeader("User-Agent", ua);
+    this->setDefaultHeader("User-Agent", ua);
+}
+
+void	MXRequestManager::setDefaultHeader(QByteArray const& name, QByteArray const& value)
+{
+    this->m_config.detach();
+    if (value.isEmpty())
+        this->m_config->defaultHeaders.remove(name);
+    else
+        this->m_config->defaultHeaders.insert(name, value);
+
+    // Built once here, only shared by the requests afterwards
+    MXEncodedMapIterator	i(this->m_config->defaultHeaders);
+
+    this->m_config->requestTemplate = QNetworkRequest();
+    while (i.hasNext())
+    {
+        i.next();
+        this->m_config->requestTemplate.setRawHeader(i.key(), i.value());
+    }
+}
+
+void	MXRequestManager::setRequestHeader(QByteArray const& name, QByteArray const& value)
+{
+    this->m_netNextHeaders.append(MXEncodedPair(name, value));
 }
 
 void	MXRequestManager::setResponseType(SupportedContentTypes const& responseType)
 {
-    this->m_responseType = responseType;
+    this->m_config.detach();
+    this->m_config->responseType = responseType;
+}
+
+int		MXRequestManager::progressInterval(void) const
+{
+    return (this->m_config->progressInterval);
+}
+
+void	MXRequestManager::setProgressInterval(int ms)
+{
+    this->m_config.detach();
+    this->m_config->progressInterval = qMax(0, ms);
+}
+
+int		MXRequestManager::timeout(void) const
+{
+    return (this->m_config->timeout);
+}
+
+void	MXRequestManager::setTimeout(int ms)
+{
+    this->m_config.detach();
+    this->m_config->timeout = qMax(0, ms);
+}
+
+int		MXRequestManager::idleTimeout(void) const
+{
+    return (this->m_config->idleTimeout);
+}
+
+void	MXRequestManager::setIdleTimeout(int ms)
+{
+    this->m_config.detach();
+    this->m_config->idleTimeout = qMax(0, ms);
+}
+
+void	MXRequestManager::setRequestTimeout(int timeout, int idleTimeout)
+{
+    this->m_netNextTimeout = qMax(-1, timeout);
+    this->m_netNextIdleTimeout = qMax(-1, idleTimeout);
+}
+
+MXRequestRecorder	*MXRequestManager::recorder(void) const
+{
+    return (this->m_recorder.data());
+}
+
+void	MXRequestManager::setRecorder(MXRequestRecorder *recorder)
+{
+    this->m_recorder = recorder;
+}
+
+MXRequestMetrics	*MXRequestManager::metrics(void) const
+{
+    return (this->m_metrics.data());
+}
+
+void	MXRequestManager::setMetrics(MXRequestMetrics *metrics)
+{
+    this->m_metrics = metrics;
 }
 
 // ---
@@ -242,52 +572,48 @@ bool	MXRequestManager::request(QString const& resource, QString const& method,
     this->m_httpAuthCount = 0;
 
     QUrlQuery	urlQuery;
-    QUrl        apiUrl(this->m_netBaseApiUrl);
+    QUrl        apiUrl(this->nextApiUrl());
 
     apiUrl.setPath(resource);
     urlQuery.setQueryItems(data);
     if (method != "POST")
         apiUrl.setQuery(urlQuery);
-    this->m_netRequest->setUrl(apiUrl);
+    this->prepareRequest(apiUrl);
 
     emit this->begin();
 
-//    if (this->m_responseType == JSON)
-//        this->m_netRequest->setRawHeader("Accept", "application/json,application/xml;q=0.9,*/*;q=0.8");
     if (method.toUpper() == "DELETE")
-        this->m_netReply = this->deleteResource(*(this->m_netRequest));
+        this->m_netReply = this->transport()->deleteResource(*(this->m_netRequest));
     else if (method.toUpper() == "GET")
-        this->m_netReply = this->get(*(this->m_netRequest));
+        this->m_netReply = this->transport()->get(*(this->m_netRequest));
     else if (method.toUpper() == "HEAD")
-        this->m_netReply = this->head(*(this->m_netRequest));
+        this->m_netReply = this->transport()->head(*(this->m_netRequest));
     else if (method.toUpper() == "POST")
     {
 //        QUrl tmpUrl;
 //        tmpUrl.setQuery(urlQuery);
 
-//        qDebug() << "Api URL:" << apiUrl;
-//        qDebug() << "Method:" << method;
-//        qDebug() << "Url Query:" << urlQuery.toString();
-//        qDebug() << "tmpUrl:" << tmpUrl;
-//        qDebug() << "tmpUrl Query:" << tmpUrl.toEncoded();
+//        qCDebug(lcMXRequest) << "Api URL:" << apiUrl;
+//        qCDebug(lcMXRequest) << "Method:" << method;
+//        qCDebug(lcMXRequest) << "Url Query:" << urlQuery.toString();
+//        qCDebug(lcMXRequest) << "tmpUrl:" << tmpUrl;
+//        qCDebug(lcMXRequest) << "tmpUrl Query:" << tmpUrl.toEncoded();
 //        return (false);
 
         this->m_netRequest->setHeader(QNetworkRequest::ContentTypeHeader,
                                       "application/x-www-form-urlencoded; charset=utf-8");
-        this->m_netReply = this->post(*(this->m_netRequest), urlQuery.toString().toUtf8());
+        this->m_netReply = this->transport()->post(*(this->m_netRequest), urlQuery.toString().toUtf8());
     }
     else if (method.toUpper() == "PUT")
     {
         this->m_netRequest->setHeader(QNetworkRequest::ContentLengthHeader, 0);
-        this->m_netReply = this->put(*(this->m_netRequest), (QIODevice*)NULL);
+        this->m_netReply = this->transport()->put(*(this->m_netRequest), (QIODevice*)NULL);
     }
     else
-        this->m_netReply = this->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
+        this->m_netReply = this->transport()->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
 
-    connect(this->m_netReply, SIGNAL(downloadProgress(qint64,qint64)),
-            SLOT(requestDownloadProgress(qint64,qint64)));
-    connect(this->m_netReply, SIGNAL(uploadProgress(qint64,qint64)),
-            SLOT(requestUploadProgress(qint64,qint64)));
+    this->startReply(method, method.toUpper() == "POST" ? urlQuery.toString().toUtf8()
+                                                        : QByteArray());
     return (true);
 }
 
@@ -309,34 +635,28 @@ bool	MXRequestManager::request(QString const& resource, QString const& method,
 {
     this->m_httpAuthCount = 0;
     if (resource.isEmpty() || method.isEmpty())
-        return (false);
+        return (this->discardNext());
 
-    QUrl apiUrl(this->m_netBaseApiUrl);
-    apiUrl.setPath(resource);
-    this->m_netRequest->setUrl(apiUrl);
+    this->prepareRequest(QUrl(this->nextApiUrl().toString()+resource));
 
     emit this->begin();
 
-    this->m_netRequest->setUrl(this->m_netBaseApiUrl.toString()+resource);
-//    if (this->m_responseType == JSON)
-//        this->m_netRequest->setRawHeader("Accept", "application/json,application/xml;q=0.9,*/*;q=0.8");
-    if (method.toUpper() == "DELETE")
-        this->m_netReply = this->deleteResource(*(this->m_netRequest));
+    if (method.toUpper() == "DELETE" && data == NULL)
+        this->m_netReply = this->transport()->deleteResource(*(this->m_netRequest));
     else if (method.toUpper() == "GET")
-        this->m_netReply = this->get(*(this->m_netRequest));
+        this->m_netReply = this->transport()->get(*(this->m_netRequest));
     else if (method.toUpper() == "HEAD")
-        this->m_netReply = this->head(*(this->m_netRequest));
+        this->m_netReply = this->transport()->head(*(this->m_netRequest));
     else if (method.toUpper() == "POST")
-        this->m_netReply = this->post(*(this->m_netRequest), data);
+        this->m_netReply = this->transport()->post(*(this->m_netRequest), data);
     else if (method.toUpper() == "PUT")
-        this->m_netReply = this->put(*(this->m_netRequest), data);
-    else
-        this->m_netReply = this->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
+        this->m_netReply = this->transport()->put(*(this->m_netRequest), data);
+    else // PATCH, DELETE with a body, ...
+        this->m_netReply = this->transport()->sendCustomRequest(*(this->m_netRequest),
+                                                                method.toLatin1(), data);
 
-    connect(this->m_netReply, SIGNAL(downloadProgress(qint64,qint64)),
-            SLOT(requestDownloadProgress(qint64,qint64)));
-    connect(this->m_netReply, SIGNAL(uploadProgress(qint64,qint64)),
-            SLOT(requestUploadProgress(qint64,qint64)));
+    this->startReply(method, QByteArray(), false,
+                     data && !data->isSequential() ? data->size() - data->pos() : -1);
     return (true);
 }
 
@@ -345,34 +665,36 @@ bool	MXRequestManager::request(QString const& resource, QString const& method,
 {
     this->m_httpAuthCount = 0;
     if (resource.isEmpty() || method.isEmpty())
-        return (false);
+        return (this->discardNext());
 
-    QUrl apiUrl(this->m_netBaseApiUrl);
-    apiUrl.setPath(resource);
-    this->m_netRequest->setUrl(apiUrl);
+    this->prepareRequest(QUrl(this->nextApiUrl().toString()+resource));
 
     emit this->begin();
 
-    this->m_netRequest->setUrl(this->m_netBaseApiUrl.toString()+resource);
-//    if (this->m_responseType == JSON)
-//        this->m_netRequest->setRawHeader("Accept", "application/json,application/xml;q=0.9,*/*;q=0.8");
-    if (method.toUpper() == "DELETE")
-        this->m_netReply = this->deleteResource(*(this->m_netRequest));
+    if (method.toUpper() == "DELETE" && data.isEmpty())
+        this->m_netReply = this->transport()->deleteResource(*(this->m_netRequest));
     else if (method.toUpper() == "GET")
-        this->m_netReply = this->get(*(this->m_netRequest));
+        this->m_netReply = this->transport()->get(*(this->m_netRequest));
     else if (method.toUpper() == "HEAD")
-        this->m_netReply = this->head(*(this->m_netRequest));
+        this->m_netReply = this->transport()->head(*(this->m_netRequest));
     else if (method.toUpper() == "POST")
-        this->m_netReply = this->post(*(this->m_netRequest), data);
+        this->m_netReply = this->transport()->post(*(this->m_netRequest), data);
     else if (method.toUpper() == "PUT")
-        this->m_netReply = this->put(*(this->m_netRequest), data);
-    else
-        this->m_netReply = this->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
+        this->m_netReply = this->transport()->put(*(this->m_netRequest), data);
+    else if (data.isEmpty())
+        this->m_netReply = this->transport()->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
+    else // PATCH, DELETE with a body, ...: the body is read by the reply
+    {
+        QBuffer	*buffer = new QBuffer;
 
-    connect(this->m_netReply, SIGNAL(downloadProgress(qint64,qint64)),
-            SLOT(requestDownloadProgress(qint64,qint64)));
-    connect(this->m_netReply, SIGNAL(uploadProgress(qint64,qint64)),
-            SLOT(requestUploadProgress(qint64,qint64)));
+        buffer->setData(data);
+        buffer->open(QIODevice::ReadOnly);
+        this->m_netReply = this->transport()->sendCustomRequest(*(this->m_netRequest),
+                                                                method.toLatin1(), buffer);
+        buffer->setParent(this->m_netReply);
+    }
+
+    this->startReply(method, data);
     return (true);
 }
 
@@ -381,43 +703,489 @@ bool	MXRequestManager::request(QString const& resource, QString const& method,
 {
     this->m_httpAuthCount = 0;
     if (resource.isEmpty() || method.isEmpty())
-        return (false);
+        return (this->discardNext());
 
-    QUrl apiUrl(this->m_netBaseApiUrl);
-    apiUrl.setPath(resource);
-    this->m_netRequest->setUrl(apiUrl);
+    this->prepareRequest(QUrl(this->nextApiUrl().toString()+resource));
 
     emit this->begin();
 
-    this->m_netRequest->setUrl(this->m_netBaseApiUrl.toString()+resource);
-//    if (this->m_responseType == JSON)
-//        this->m_netRequest->setRawHeader("Accept", "application/json,application/xml;q=0.9,*/*;q=0.8");
     if (method.toUpper() == "DELETE")
-        this->m_netReply = this->deleteResource(*(this->m_netRequest));
+        this->m_netReply = this->transport()->deleteResource(*(this->m_netRequest));
     else if (method.toUpper() == "GET")
-        this->m_netReply = this->get(*(this->m_netRequest));
+        this->m_netReply = this->transport()->get(*(this->m_netRequest));
     else if (method.toUpper() == "HEAD")
-        this->m_netReply = this->head(*(this->m_netRequest));
+        this->m_netReply = this->transport()->head(*(this->m_netRequest));
     else if (method.toUpper() == "POST")
-        this->m_netReply = this->post(*(this->m_netRequest), data);
+        this->m_netReply = this->transport()->post(*(this->m_netRequest), data);
     else if (method.toUpper() == "PUT")
-        this->m_netReply = this->put(*(this->m_netRequest), data);
+        this->m_netReply = this->transport()->put(*(this->m_netRequest), data);
     else
-        this->m_netReply = this->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
+        this->m_netReply = this->transport()->sendCustomRequest(*(this->m_netRequest), method.toLatin1());
 
-    connect(this->m_netReply, SIGNAL(downloadProgress(qint64,qint64)),
-            SLOT(requestDownloadProgress(qint64,qint64)));
-    connect(this->m_netReply, SIGNAL(uploadProgress(qint64,qint64)),
-            SLOT(requestUploadProgress(qint64,qint64)));
+    this->startReply(method, QByteArray(), false);
+    return (true);
+}
+
+void	MXRequestManager::startReply(QString const& method, QByteArray const& body,
+                                     bool bodyCaptured, qint64 bodySize)
+{
+    Deadline	deadline;
+
+    this->m_netReplies.insert(this->m_netReply);
+    this->watchReply(this->m_netReply);
+
+    deadline.timeout = this->m_netNextTimeout < 0 ? this->m_config->timeout
+                                                  : this->m_netNextTimeout;
+    deadline.idle = this->m_netNextIdleTimeout < 0 ? this->m_config->idleTimeout
+                                                   : this->m_netNextIdleTimeout;
+    this->m_netNextTimeout = -1;
+    this->m_netNextIdleTimeout = -1;
+    if (deadline.timeout > 0 || deadline.idle > 0)
+    {
+        deadline.clock.start();
+        this->addDeadline(this->m_netReply, deadline);
+    }
+
+    if (!this->m_recorder.isNull())
+        this->m_recorder->recordRequest(this->m_netReply, method.toUpper(),
+                                        *(this->m_netRequest), body, bodyCaptured);
+    if (!this->m_metrics.isNull())
+        this->m_metrics->recordRequest(this->m_netReply, method, this->m_netRequest->url(),
+                                       bodyCaptured ? body.size() : bodySize);
+
+    if (this->m_netNextEndpoint >= 0)
+    {
+        Route	route;
+
+        route.pool = this->m_config->endpoints;
+        route.endpoint = this->m_netNextEndpoint;
+        route.timer.start();
+        this->m_netRoutes.insert(this->m_netReply, route);
+        this->m_netNextEndpoint = -1;
+
+        // Only GETs are idempotent enough to be sent twice
+        if (method.toUpper() == "GET" && this->m_config->hedgePercentile > 0
+            && route.pool->size() > 1 && route.pool->samples() >= HEDGE_MIN_SAMPLES)
+        {
+            QPointer<QNetworkReply>	primary(this->m_netReply);
+            quint64					delay = route.pool->latencyPercentile(
+                                                this->m_config->hedgePercentile) / 1000;
+
+            QTimer::singleShot(int(qBound(quint64(1), delay, quint64(INT_MAX))), this,
+                               [this, primary]() {
+                if (!primary.isNull())
+                    this->hedge(primary.data());
+            });
+        }
+    }
+}
+
+QUrl	MXRequestManager::nextApiUrl(void)
+{
+    if (this->m_config->endpoints.isNull())
+        return (this->m_config->baseApiUrl);
+    this->m_netNextEndpoint = this->m_config->endpoints->pick();
+    return (this->m_config->endpoints->url(this->m_netNextEndpoint));
+}
+
+void	MXRequestManager::hedge(QNetworkReply *primary)
+{
+    QNetworkRequest	request;
+    QNetworkReply	*twin;
+    Route			route;
+    int				index;
+
+    if (!this->m_netReplies.contains(primary) || !this->m_netRoutes.contains(primary)
+        || primary->isFinished() || !this->m_netRoutes.value(primary).twin.isNull())
+        return;
+    route = this->m_netRoutes.value(primary);
+    if ((index = route.pool->pick(route.endpoint)) < 0)
+        return;
+
+    request = primary->request();
+    request.setUrl(route.pool->rebase(request.url(), route.endpoint, index));
+    if (request.url().scheme() == "https") // The ticket of the other host
+        MXSessionCache::prepare(request);
+    twin = this->transport()->get(request);
+    this->m_netReplies.insert(twin);
+    this->watchReply(twin);
+    if (this->m_netDeadlines.contains(primary)) // Same deadline as the original
+        this->addDeadline(twin, this->m_netDeadlines.value(primary));
+    if (!this->m_metrics.isNull())
+        this->m_metrics->recordRequest(twin, "GET", request.url(), 0);
+    qCDebug(lcMXRequest) << "Hedging" << primary->url() << "with" << request.url();
+
+    this->m_netRoutes[primary].twin = twin;
+    route.endpoint = index;
+    route.timer.start();
+    route.twin = primary;
+    this->m_netRoutes.insert(twin, route);
+}
+
+bool	MXRequestManager::settleRoute(QNetworkReply *reply)
+{
+    Route			route = this->m_netRoutes.take(reply);
+    QNetworkReply	*twin = route.twin.data();
+    Interruption	interruption = this->m_netInterruptions.value(reply, NotInterrupted);
+    bool			failed = this->m_lastHttpCode >= 500 || interruption != NotInterrupted
+                             || (this->m_lastHttpCode == 0
+                                 && reply->error() != QNetworkReply::NoError);
+
+    // A cancellation says nothing about the endpoint
+    route.pool->release(route.endpoint, interruption == Canceled
+                                        ? -1 : route.timer.nsecsElapsed() / 1000, !failed);
+    if (twin == NULL || !this->m_netReplies.contains(twin))
+        return (true);
+
+    if (failed) // The copy may still succeed: it takes over
+    {
+        if (this->m_netFutures.contains(reply))
+            this->m_netFutures.insert(twin, this->m_netFutures.take(reply));
+        if (!this->m_recorder.isNull())
+            this->m_recorder->moveRequest(reply, twin);
+        this->m_netRoutes[twin].twin.clear();
+        this->dropReply(reply, false);
+        return (false);
+    }
+
+    if (this->m_netFutures.contains(twin))
+        this->m_netFutures.insert(reply, this->m_netFutures.take(twin));
+    if (!this->m_recorder.isNull())
+        this->m_recorder->moveRequest(twin, reply);
+    this->dropReply(twin, true);
+    return (true);
+}
+
+void	MXRequestManager::dropReply(QNetworkReply *reply, bool abort)
+{
+    reply->disconnect(this);
+    if (abort)
+        reply->abort();
+    if (this->m_netRoutes.contains(reply))
+    {
+        Route	route = this->m_netRoutes.take(reply);
+
+        route.pool->release(route.endpoint, -1, true);
+    }
+    if (!this->m_metrics.isNull())
+        this->m_metrics->recordResponse(reply, reply->attribute(
+                                            QNetworkRequest::HttpStatusCodeAttribute).toInt(),
+                                        0, true);
+    if (!this->m_recorder.isNull())
+        this->m_recorder->discardRequest(reply);
+    if (this->m_netDeadlines.contains(reply))
+        this->m_netDeadlines.take(reply).timer->stop();
+    this->m_netInterruptions.remove(reply);
+    this->m_netReplies.remove(reply);
+    this->m_netProgress.remove(reply);
+    reply->deleteLater();
+}
+
+void	MXRequestManager::addDeadline(QNetworkReply *reply, Deadline deadline)
+{
+    deadline.activity.start();
+    deadline.timer = new QTimer(reply);
+    deadline.timer->setSingleShot(true);
+    connect(deadline.timer, SIGNAL(timeout()), SLOT(deadlineExpired()));
+    this->m_netDeadlines.insert(reply, deadline);
+    this->armDeadline(reply);
+}
+
+void	MXRequestManager::armDeadline(QNetworkReply *reply)
+{
+    Deadline const&	deadline = this->m_netDeadlines[reply];
+    qint64			wait = LLONG_MAX;
+
+    if (deadline.timeout > 0)
+        wait = deadline.timeout - deadline.clock.elapsed();
+    if (deadline.idle > 0)
+        wait = qMin(wait, deadline.idle - deadline.activity.elapsed());
+    deadline.timer->start(int(qBound(qint64(0), wait, qint64(INT_MAX))));
+}
+
+void	MXRequestManager::interrupt(QNetworkReply *reply, Interruption why)
+{
+    QNetworkReply	*twin = this->m_netRoutes.value(reply).twin.data();
+
+    if (!this->m_netReplies.contains(reply) || this->m_netInterruptions.contains(reply))
+        return;
+
+    // Both copies of a hedged request go, through the one holding the future
+    if (twin != NULL && this->m_netReplies.contains(twin))
+    {
+        if (this->m_netFutures.contains(twin))
+            qSwap(reply, twin);
+        this->m_netRoutes[reply].twin.clear();
+        this->dropReply(twin, true);
+    }
+
+    qCDebug(lcMXRequest) << "Interrupting" << reply->url() << "- reason:" << why;
+    this->m_netInterruptions.insert(reply, why);
+    if (this->m_netDeadlines.contains(reply))
+        this->m_netDeadlines.value(reply).timer->stop();
+    reply->abort(); // Emits finished(), treated by requestFinished()
+}
+
+MXRequestManager::Progress&	MXRequestManager::progressOf(QNetworkReply *reply)
+{
+    if (reply != NULL && this->m_netReplies.contains(reply))
+        return (this->m_netProgress[reply]);
+    return (this->m_looseProgress);
+}
+
+bool	MXRequestManager::progressDue(QNetworkReply *reply, bool download)
+{
+    Progress		&progress = this->progressOf(reply);
+    QElapsedTimer	&clock = download ? progress.downloadClock : progress.uploadClock;
+    qint64			done = download ? progress.bytesReceived : progress.bytesSent;
+    qint64			total = download ? progress.bytesReceivedTotal : progress.bytesSentTotal;
+    int				interval = this->m_config->progressInterval;
+    int				wait;
+
+    // The last signal of a known size transfer isn't delayed
+    if (interval <= 0 || done == total || !clock.isValid() || clock.hasExpired(interval))
+        return (true);
+
+    if (download)
+        progress.downloadPending = true;
+    else
+        progress.uploadPending = true;
+    wait = qMax(0, interval - int(clock.elapsed()));
+    if (!this->m_progressTimer.isActive() || this->m_progressTimer.remainingTime() > wait)
+        this->m_progressTimer.start(wait);
+    return (false);
+}
+
+void	MXRequestManager::emitProgress(QNetworkReply *reply, bool download)
+{
+    Progress	&progress = this->progressOf(reply);
+    qint64		done = download ? progress.bytesReceived : progress.bytesSent;
+    qint64		total = download ? progress.bytesReceivedTotal : progress.bytesSentTotal;
+    qint64		sumDone = done;
+    qint64		sumTotal = total;
+
+    if (download)
+    {
+        progress.downloadClock.start();
+        progress.downloadPending = false;
+    }
+    else
+    {
+        progress.uploadClock.start();
+        progress.uploadPending = false;
+    }
+    this->sumProgress(download, &sumDone, &sumTotal);
+
+    // Slots may finish or drop the reply: progress isn't used past this point
+    if (download)
+    {
+        qCDebug(lcMXRequest) << "Download Request BytesReceived/BytesAvailable: "
+                 << done << '/' << total;
+        emit this->downloadProgress(done, total);
+        emit this->totalDownloadProgress(sumDone, sumTotal);
+    }
+    else
+    {
+        qCDebug(lcMXRequest) << "Upload Request BytesReceived/BytesAvailable: "
+                 << done << '/' << total;
+        emit this->uploadProgress(done, total);
+        emit this->totalUploadProgress(sumDone, sumTotal);
+    }
+}
+
+void	MXRequestManager::sumProgress(bool download, qint64 *done, qint64 *total) const
+{
+    QHashIterator<QNetworkReply*, Progress>	i(this->m_netProgress);
+    qint64									partDone;
+    qint64									partTotal;
+
+    if (this->m_netProgress.isEmpty())
+        return;
+
+    *done = 0;
+    *total = 0;
+    while (i.hasNext())
+    {
+        i.next();
+        partDone = download ? i.value().bytesReceived : i.value().bytesSent;
+        partTotal = download ? i.value().bytesReceivedTotal : i.value().bytesSentTotal;
+        *done += partDone;
+        if (*total < 0 || partTotal < 0)
+            *total = -1;
+        else
+            *total += partTotal;
+    }
+}
+
+void	MXRequestManager::prepareRequest(QUrl const& url)
+{
+    int	i = -1;
+
+    // Shares the template's headers, detached once by setUrl()
+    *(this->m_netRequest) = this->m_config->requestTemplate;
+    this->m_netRequest->setUrl(url);
+    if (url.scheme() == "https")
+        MXSessionCache::prepare(*(this->m_netRequest));
+    while (++i < this->m_netNextHeaders.size())
+        this->m_netRequest->setRawHeader(this->m_netNextHeaders.at(i).first,
+                                         this->m_netNextHeaders.at(i).second);
+    this->m_netNextHeaders.clear();
+}
+
+bool	MXRequestManager::discardNext(void)
+{
+    this->m_netNextHeaders.clear();
+    this->m_netNextTimeout = -1;
+    this->m_netNextIdleTimeout = -1;
+    return (false);
+}
+
+QFuture<MXRequestManager::Response>	MXRequestManager::requestAsync(QString const& resource,
+                                                                   QString const& method)
+{
+    return (this->requestAsync(resource, method, MXMap()));
+}
+
+bool	MXRequestManager::cancel(QFuture<Response> const& future)
+{
+    QMutableHashIterator<QNetworkReply*, QFutureInterface<Response> >	i(this->m_netFutures);
+
+    while (i.hasNext())
+    {
+        i.next();
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        if (i.value().future() == future)
+#else
+        if (i.value() == future.d) // QFuture has no operator== anymore
+#endif
+        {
+            this->interrupt(i.key(), Canceled);
+            return (true);
+        }
+    }
+    return (false);
+}
+
+void	MXRequestManager::cancelAll(void)
+{
+    QList<QNetworkReply*>	replies = this->m_netReplies.values();
+    int						i = -1;
+
+    // Interrupting a reply may drop its hedged copy from the list
+    while (++i < replies.size())
+        if (this->m_netReplies.contains(replies.at(i)))
+            this->interrupt(replies.at(i), Canceled);
+}
+
+QFuture<MXRequestManager::Response>	MXRequestManager::futureFor(QNetworkReply *reply)
+{
+    QFutureInterface<Response>	future;
+
+    future.reportStarted();
+    if (reply == NULL)
+    {
+        future.reportResult(Response());
+        future.reportFinished();
+        return (future.future());
+    }
+    this->m_netFutures.insert(reply, future);
+    return (future.future());
+}
+
+bool	MXRequestManager::request(QString const& resource, QString const& method,
+                                  MXMultiPartBody *data)
+{
+    if (data == NULL || resource.isEmpty() || method.isEmpty())
+        return (this->discardNext());
+    if (!data->isOpen() && !data->open(QIODevice::ReadOnly))
+        return (this->discardNext());
+
+    this->setRequestHeader("Content-Type", data->contentType());
+    this->setRequestHeader("Content-Length", QByteArray::number(data->size()));
+    if (!this->request(resource, method, static_cast<QIODevice*>(data)))
+        return (false);
+
+    connect(data, SIGNAL(partProgress(int,qint64,qint64)),
+            SIGNAL(uploadPartProgress(int,qint64,qint64)), Qt::UniqueConnection);
+    if (data->parent() == NULL)
+        data->setParent(this->m_netReply);
     return (true);
 }
 
+bool	MXRequestManager::request(QString const& resource, QString const& method,
+                                  QJsonObject const& data)
+{
+    return (this->requestEncoded(resource, method, toJsonBody(data), "application/json"));
+}
+
+bool	MXRequestManager::request(QString const& resource, QString const& method,
+                                  QJsonArray const& data)
+{
+    return (this->requestEncoded(resource, method, toJsonBody(data), "application/json"));
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+bool	MXRequestManager::request(QString const& resource, QString const& method,
+                                  QCborMap const& data)
+{
+    return (this->requestEncoded(resource, method, QCborValue(data).toCbor(),
+                                 "application/cbor"));
+}
+
+bool	MXRequestManager::request(QString const& resource, QString const& method,
+                                  QCborArray const& data)
+{
+    return (this->requestEncoded(resource, method, QCborValue(data).toCbor(),
+                                 "application/cbor"));
+}
+#endif
+
+bool	MXRequestManager::requestEncoded(QString const& resource, QString const& method,
+                                         QByteArray const& body, QByteArray const& contentType)
+{
+    if (resource.isEmpty() || method.isEmpty())
+        return (this->discardNext());
+
+    this->setRequestHeader("Content-Type", contentType);
+    return (this->request(resource, method, body));
+}
+
+QByteArray	MXRequestManager::toJsonBody(QJsonValue const& value)
+{
+    QByteArray	body;
+
+    if (value.isObject())
+        return (QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+    if (value.isArray())
+        return (QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+
+    // QJsonDocument only holds objects/arrays: strip the wrapping array
+    body = QJsonDocument(QJsonArray() << value).toJson(QJsonDocument::Compact);
+    return (body.mid(1, body.size() - 2));
+}
+
+QJsonObject	MXRequestManager::toJsonObject(QMetaObject const& metaObject, void const *gadget)
+{
+    QJsonObject	object;
+    int			i = -1;
+
+    while (++i < metaObject.propertyCount())
+    {
+        QMetaProperty	property = metaObject.property(i);
+
+        if (property.isReadable())
+            object.insert(QString::fromLatin1(property.name()),
+                          QJsonValue::fromVariant(property.readOnGadget(gadget)));
+    }
+    return (object);
+}
+
 bool	MXRequestManager::parseResponse(QString const& contentType,
                                         QByteArray const& response)
 {
     QString	parsingErrorString;
 
-    if (this->m_responseType == JSON)
+    if (this->m_config->responseType == JSON)
     {
         if (contentType.left(16).compare("application/json",
                                          Qt::CaseInsensitive) == 0) // JSON
@@ -432,9 +1200,9 @@ bool	MXRequestManager::parseResponse(QString const& contentType,
         }
     }
 
-    qDebug() << "= Parsing error =";
-    qDebug() << "Server error:" << response;
-    qDebug() << "Client error:" << parsingErrorString;
+    qCDebug(lcMXRequest) << "= Parsing error =";
+    qCDebug(lcMXRequest) << "Server error:" << response;
+    qCDebug(lcMXRequest) << "Client error:" << parsingErrorString;
 
     emit this->parsingError();
     emit this->finishedWithError();
@@ -446,9 +1214,10 @@ bool	MXRequestManager::parseResponse(QString const& contentType,
 void	MXRequestManager::requestError(QNetworkReply::NetworkError code)
 {
     if (code != QNetworkReply::NoError)
-        qDebug() << "Network Error " << code << ": " << this->m_netReply->errorString();
+        qCDebug(lcMXRequest) << "Network Error " << code << ": "
+                 << (this->m_netReply.isNull() ? QString() : this->m_netReply->errorString());
     else
-        qDebug() << "Error Emitted: No Error...";
+        qCDebug(lcMXRequest) << "Error Emitted: No Error...";
 
     emit this->finishedWithError();
     emit this->finished(false);
@@ -457,68 +1226,230 @@ void	MXRequestManager::requestError(QNetworkReply::NetworkError code)
 void	MXRequestManager::requestFinished(QNetworkReply *reply)
 {
     bool requestOk = true;
+    bool networkOk = true;
+
+#ifndef	QT_NO_SSL
+    // Under TLS 1.3, the ticket comes after the handshake: usually not there yet at encrypted()
+    if (reply->url().scheme() == "https")
+        MXSessionCache::store(reply->url(), reply->sslConfiguration());
+#endif
 
     this->m_lastHttpCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    this->m_lastInterruption = this->m_netInterruptions.value(reply, NotInterrupted);
+    if (this->m_netRoutes.contains(reply) && !this->settleRoute(reply))
+        return; // Failed, but its hedged copy is still running
+    this->m_netInterruptions.remove(reply);
+
+    // Coalesced progress isn't left behind: the last one is always delivered
+    if (this->m_netProgress.value(reply).downloadPending)
+        this->emitProgress(reply, true);
+    if (this->m_netProgress.value(reply).uploadPending)
+        this->emitProgress(reply, false);
+    if (this->m_netDeadlines.contains(reply))
+        this->m_netDeadlines.take(reply).timer->stop();
+
+    // Grouped: none of this is formatted while the category is disabled
+    if (lcMXRequest().isDebugEnabled())
+    {
+        qCDebug(lcMXRequest) << "##### Request Finished #####";
+        qCDebug(lcMXRequest) << "----- Request Data -----";
+        qCDebug(lcMXRequest) << "API:" << this->m_netRequest->url().toDisplayString();
+        qCDebug(lcMXRequest) << "Ressource:" << this->m_netRequest->url().path();
+        qCDebug(lcMXRequest) << "Known headers:" << this->m_netRequest->rawHeaderList();
+        qCDebug(lcMXRequest) << "Encoded Query:"
+                             << this->m_netRequest->url().query(QUrl::FullyEncoded);
+        qCDebug(lcMXRequest) << "Method:" <<
+                    this->m_netRequest->attribute(QNetworkRequest::CustomVerbAttribute,
+                                QVariant("Unknown")).toString();
+        qCDebug(lcMXRequest) << "----- /Request Data -----";
+        qCDebug(lcMXRequest) << "- HTTP Error code:" << this->m_lastHttpCode;
+        qCDebug(lcMXRequest) << "- Qt Network Error:" << reply->error() << " - "
+                             << reply->errorString();
+    }
+    if ((reply->error() != QNetworkReply::NoError && this->m_lastHttpCode == 0)
+        || this->m_lastInterruption != NotInterrupted)
+        networkOk = false;
+
+    // What an interrupted reply got so far is partial: freed with it
+    if (this->m_lastInterruption == NotInterrupted)
+        this->m_netDataRaw = reply->readAll();
+    else
+        this->m_netDataRaw.clear();
+    if (!this->m_recorder.isNull())
+        this->m_recorder->recordResponse(reply, this->m_lastHttpCode, this->m_netDataRaw);
+    if (lcMXRequest().isDebugEnabled())
+    {
+        qCDebug(lcMXRequest) << "--- Reply ---";
+        qCDebug(lcMXRequest) << "- Headers:" << reply->rawHeaderPairs();
+        qCDebug(lcMXRequest) << "- Body:" << this->m_netDataRaw;
+        qCDebug(lcMXRequest) << "--- /Reply ---";
+        qCDebug(lcMXRequest) << "##### /Request Finished #####";
+    }
+
+    requestOk = networkOk && this->parseResponse(reply->
+                                                 header(QNetworkRequest::ContentTypeHeader)
+                                                 .toString(), this->m_netDataRaw);
+    if (!this->m_metrics.isNull())
+        this->m_metrics->recordResponse(reply, this->m_lastHttpCode, this->m_netDataRaw.size(),
+                                        !networkOk || requestOk);
+
+    if (this->m_netFutures.contains(reply))
+    {
+        QFutureInterface<Response>	future = this->m_netFutures.take(reply);
+        Response					response;
+
+        response.ok = requestOk;
+        response.httpCode = this->m_lastHttpCode;
+        response.error = reply->error();
+        response.errorString = reply->errorString();
+        response.interruption = this->m_lastInterruption;
+        if (this->m_lastInterruption == TimedOut || this->m_lastInterruption == IdleTimedOut)
+        {
+            response.error = QNetworkReply::TimeoutError;
+            response.errorString = this->m_lastInterruption == TimedOut
+                                   ? "Request timed out" : "Transfer idle for too long";
+        }
+        response.rawData = this->m_netDataRaw;
+        if (requestOk)
+            response.data = this->m_netDataMap;
+        response.headers = reply->rawHeaderPairs();
+        future.reportResult(response);
+        future.reportFinished();
+    }
 
-    qDebug() << "##### Request Finished #####";
-    qDebug() << "----- Request Data -----";
-    qDebug() << "API:" << this->m_netRequest->url().toDisplayString();
-    qDebug() << "Ressource:" << this->m_netRequest->url().path();
-    qDebug() << "Known headers:" << this->m_netRequest->rawHeaderList();
-    qDebug() << "Encoded Query:" << this->m_netRequest->url().query(QUrl::FullyEncoded);
-    qDebug() << "Method:" <<
-                this->m_netRequest->attribute(QNetworkRequest::CustomVerbAttribute,
-                            QVariant("Unknown")).toString();
-    qDebug() << "----- /Request Data -----";
-    qDebug() << "- HTTP Error code:" << this->m_lastHttpCode;
-    qDebug() << "- Qt Network Error:" << reply->error() << " - " << reply->errorString();
-    if (reply->error() != QNetworkReply::NoError && this->m_lastHttpCode == 0)
-        requestOk = false;
-
-    this->m_netDataRaw = reply->readAll();
-    qDebug() << "--- Reply ---";
-    qDebug() << "- Headers:" << reply->rawHeaderPairs();
-    qDebug() << "- Body:" << this->m_netDataRaw;
-    qDebug() << "--- /Reply ---";
-
-    qDebug() << "##### /Request Finished #####";
-
-    if (!requestOk)
+    // The transport is shared and long-lived, so replies aren't left to it
+    this->m_netReplies.remove(reply);
+    this->m_netProgress.remove(reply);
+    emit QNetworkAccessManager::finished(reply);
+    reply->deleteLater();
+
+    if (!networkOk)
         this->requestError(reply->error());
     else
-        emit this->finished(requestOk &&
-                                        this->parseResponse(reply->
-                                        header(QNetworkRequest::ContentTypeHeader)
-                                        .toString(), this->m_netDataRaw));
+        emit this->finished(requestOk);
 }
 
 void	MXRequestManager::requestDownloadProgress(qint64 bytesReceived,
                                                   qint64 bytesTotal)
 {
-    qDebug() << "Download Request BytesReceived/BytesAvailable: "
-             << bytesReceived << '/' << bytesTotal;
-    emit this->downloadProgress(bytesReceived, bytesTotal);
+    QNetworkReply	*reply = qobject_cast<QNetworkReply*>(this->sender());
+    Progress		&progress = this->progressOf(reply);
+
+    if (reply != NULL && this->m_netDeadlines.contains(reply)) // Re-armed lazily on expiry
+        this->m_netDeadlines[reply].activity.start();
+    progress.bytesReceived = bytesReceived;
+    progress.bytesReceivedTotal = bytesTotal;
+    if (this->progressDue(reply, true))
+        this->emitProgress(reply, true);
 }
 
 void	MXRequestManager::requestUploadProgress(qint64 bytesReceived,
                                                 qint64 bytesTotal)
 {
-    qDebug() << "Upload Request BytesReceived/BytesAvailable: "
-             << bytesReceived << '/' << bytesTotal;
-    emit this->uploadProgress(bytesReceived, bytesTotal);
+    QNetworkReply	*reply = qobject_cast<QNetworkReply*>(this->sender());
+    Progress		&progress = this->progressOf(reply);
+
+    if (reply != NULL && this->m_netDeadlines.contains(reply))
+        this->m_netDeadlines[reply].activity.start();
+    progress.bytesSent = bytesReceived;
+    progress.bytesSentTotal = bytesTotal;
+    if (this->progressDue(reply, false))
+        this->emitProgress(reply, false);
 }
 
 void	MXRequestManager::requestAuth(QNetworkReply     *reply,
                                       QAuthenticator    *auth)
 {
+    // The transport is shared: only answer for our own replies
+    if (!this->m_netReplies.contains(reply))
+        return;
+
     if (++this->m_httpAuthCount == 2) {
-        qDebug() << "Wrong HTTP Auth credentials, abording.";
-        this->m_netReply->abort();
+        qCDebug(lcMXRequest) << "Wrong HTTP Auth credentials, abording.";
+        reply->abort();
     }
 
-    qDebug() << "HTTP Auth Required (" << reply->size() << "):" << reply->readAll();
-    auth->setUser(this->m_netAuthUser);
-    auth->setPassword(this->m_netAuthPass);
-    qDebug() << "Auth available:" << auth->user() << auth->password();
+    qCDebug(lcMXRequest) << "HTTP Auth Required (" << reply->size() << "):" << reply->readAll();
+    auth->setUser(this->m_config->authUser);
+    auth->setPassword(this->m_config->authPass);
+    qCDebug(lcMXRequest) << "Auth available:" << auth->user() << auth->password();
+}
+
+void	MXRequestManager::replyFinished(void)
+{
+    QNetworkReply	*reply = qobject_cast<QNetworkReply*>(this->sender());
+
+    if (reply != NULL)
+        this->requestFinished(reply);
+}
+
+void	MXRequestManager::replyEncrypted(void)
+{
+#ifndef	QT_NO_SSL
+    QNetworkReply	*reply = qobject_cast<QNetworkReply*>(this->sender());
+
+    if (reply != NULL)
+        MXSessionCache::store(reply->url(), reply->sslConfiguration());
+#endif
+}
+
+void	MXRequestManager::deadlineExpired(void)
+{
+    QNetworkReply	*reply = qobject_cast<QNetworkReply*>(this->sender()->parent());
+    QNetworkReply	*twin;
+    Deadline		deadline;
+
+    if (reply == NULL || !this->m_netDeadlines.contains(reply))
+        return;
+    deadline = this->m_netDeadlines.value(reply);
+    twin = this->m_netRoutes.value(reply).twin.data();
+
+    if (deadline.timeout > 0 && deadline.clock.hasExpired(deadline.timeout - 1))
+        this->interrupt(reply, TimedOut);
+    else if (deadline.idle <= 0 || !deadline.activity.hasExpired(deadline.idle - 1))
+        this->armDeadline(reply); // Progressed since armed
+    else if (twin != NULL && this->m_netReplies.contains(twin))
+    {
+        // Only this copy of a hedged request stalled: the other one takes over
+        if (this->m_netFutures.contains(reply))
+            this->m_netFutures.insert(twin, this->m_netFutures.take(reply));
+        this->m_netRoutes[twin].twin.clear();
+        this->dropReply(reply, true);
+    }
+    else
+        this->interrupt(reply, IdleTimedOut);
+}
+
+void	MXRequestManager::progressTimeout(void)
+{
+    QList<QNetworkReply*>	replies = this->m_netProgress.keys();
+    int						interval = this->m_config->progressInterval;
+    int						wait = -1;
+    int						i = -1;
+    int						j;
+
+    replies.prepend(NULL); // m_looseProgress
+    while (++i < replies.size())
+    {
+        j = -1;
+        while (++j < 2)
+        {
+            // Looked up again: slots may finish or drop any reply
+            if (replies.at(i) != NULL && !this->m_netReplies.contains(replies.at(i)))
+                break;
+
+            Progress		&progress = this->progressOf(replies.at(i));
+            QElapsedTimer	&clock = j == 0 ? progress.downloadClock : progress.uploadClock;
+
+            if (!(j == 0 ? progress.downloadPending : progress.uploadPending))
+                continue;
+            if (interval <= 0 || clock.hasExpired(interval))
+                this->emitProgress(replies.at(i), j == 0);
+            else if (wait < 0 || interval - clock.elapsed() < wait)
+                wait = qMax(0, interval - int(clock.elapsed()));
+        }
+    }
+    if (wait >= 0)
+        this->m_progressTimer.start(wait);
 }
 // ---
@@ -22,24 +22,46 @@
 
 # include	<QByteArray>
 # include	<QDebug>
+# include	<QElapsedTimer>
+# include	<QFuture>
+# include	<QFutureInterface>
+# include	<QHash>
 # include	<QIODevice>
+# include	<QJsonArray>
 # include	<QJsonDocument>
+# include	<QJsonObject>
 # include	<QJsonParseError>
+# include	<QJsonValue>
 # include	<QList>
 # include	<QPair>
+# include	<QPointer>
+# include	<QSet>
+# include	<QSharedData>
+# include	<QSharedPointer>
 # include	<QString>
+# include	<QTimer>
 // QtNetwork
 # include	<QtNetwork/QAuthenticator>
 # include	<QtNetwork/QHostInfo>
 # include	<QtNetwork/QHttpMultiPart>
 # include	<QtNetwork/QNetworkAccessManager>
-# include   <QtNetwork/QNetworkProxy> // Hack about infinite keychain access
+# include	<QtNetwork/QNetworkProxy>
 # include	<QtNetwork/QNetworkReply>
 # include	<QtNetwork/QNetworkRequest>
 // ---
 # include	<QUrl>
 # include	<QUrlQuery>
 # include	<QVariantMap>
+# if		QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#	include	<QCborArray>
+#	include	<QCborMap>
+#	include	<QCborValue>
+# endif
+
+class MXEndpointPool;
+class MXMultiPartBody;
+class MXRequestMetrics;
+class MXRequestRecorder;
 
 # define	MXREQUESTMANAGER_NAME		"MXRequestManager"
 # define	MXREQUESTMANAGER_VERSION	"1.4"
@@ -58,6 +80,12 @@
  * @class	MXRequestManager
  * @brief	Handles the requests
  * @extends	QNetworkAccessManager
+ *
+ * Requests are sent through a transport shared by all the copies of a manager,
+ * not through the QNetworkAccessManager base itself. The proxy, cookie jar,
+ * cache and accessibility setters below are forwarded to it, and finished()
+ * is emitted for each reply sent by this manager; calling the base setters
+ * through a QNetworkAccessManager pointer has no effect on the requests.
  */
 
 class MXRequestManager : public QNetworkAccessManager
@@ -88,18 +116,315 @@ class MXRequestManager : public QNetworkAccessManager
             JSON = 0 // Default
         };
 
+        /**
+        * @enum
+        * Why a request was stopped before its end.
+        */
+        enum Interruption
+        {
+            NotInterrupted = 0,
+            Canceled,			// By cancel() or cancelAll()
+            TimedOut,			// The total timeout elapsed
+            IdleTimedOut		// Nothing was transferred during the idle timeout
+        };
+
+        /**
+        * @struct
+        * Outcome of a single request, as delivered through QFuture.
+        */
+        struct Response
+        {
+            bool								ok;
+            int									httpCode;
+            QNetworkReply::NetworkError			error;
+            QString								errorString;
+            QByteArray							rawData;
+            QVariantMap							data;
+            QList<QNetworkReply::RawHeaderPair>	headers;
+            Interruption						interruption;	// Canceled or timed out
+
+            Response(void)
+                : ok(false), httpCode(0), error(QNetworkReply::NoError),
+                  interruption(NotInterrupted) {}
+        };
+
     private:
+        /**
+        * @struct
+        * Configuration shared between copies of a manager.
+        * Copies share it until one of them changes it (copy-on-write),
+        * while the transport (connection pool, TLS sessions, proxy) stays shared.
+        */
+        struct Config : public QSharedData
+        {
+            SupportedContentTypes					responseType;
+            QString									authUser;
+            QString									authPass;
+            QUrl									baseApiUrl;
+            MXEncodedMap							defaultHeaders;
+            QNetworkRequest							requestTemplate;	// Built from defaultHeaders
+            int										progressInterval;	// ms, 0: every chunk
+            double									hedgePercentile;	// 0: no hedging
+            int										timeout;			// ms, 0: none
+            int										idleTimeout;		// ms, 0: none
+            QSharedPointer<MXEndpointPool>			endpoints;			// NULL: baseApiUrl only
+            QSharedPointer<QNetworkAccessManager>	transport;
+
+            Config(void)
+                : progressInterval(0), hedgePercentile(0), timeout(0), idleTimeout(0) {}
+        };
+
+        /**
+        * @struct
+        * Endpoint a reply was sent to, when several base URLs are set.
+        */
+        struct Route
+        {
+            QSharedPointer<MXEndpointPool>	pool;
+            int								endpoint;
+            QElapsedTimer					timer;
+            QPointer<QNetworkReply>			twin;	// Hedged copy, or original of a hedge
+        };
+
+        /**
+        * @struct
+        * Timeouts of a reply. A hedged copy shares the clock of its original.
+        */
+        struct Deadline
+        {
+            QElapsedTimer	clock;		// Since the request was sent
+            QElapsedTimer	activity;	// Since the last progress
+            int				timeout;	// ms on clock, 0: none
+            int				idle;		// ms on activity, 0: none
+            QTimer			*timer;		// Child of the reply, armed for the nearest expiry
+        };
+
+        /**
+        * @struct
+        * Last progress of a reply, summed for the aggregate progress signals,
+        * and the throttling state of its progress signals.
+        */
+        struct Progress
+        {
+            qint64			bytesReceived;
+            qint64			bytesReceivedTotal;
+            qint64			bytesSent;
+            qint64			bytesSentTotal;
+            QElapsedTimer	downloadClock;		// Since the last download progress signal
+            QElapsedTimer	uploadClock;		// Since the last upload progress signal
+            bool			downloadPending;	// Coalesced, not signaled yet
+            bool			uploadPending;
+
+            Progress(void)
+                : bytesReceived(0), bytesReceivedTotal(-1), bytesSent(0), bytesSentTotal(-1),
+                  downloadPending(false), uploadPending(false) {}
+        };
+
         int                     m_httpAuthCount;
         int                     m_lastHttpCode;
-        SupportedContentTypes	m_responseType;
+        QExplicitlySharedDataPointer<Config>	m_config;
         QByteArray				m_netDataRaw;
-        QNetworkProxy           m_netProxy; // Hack: Keychain access
-        QNetworkReply			*m_netReply;
+        QPointer<QNetworkReply>	m_netReply;
         QNetworkRequest			*m_netRequest;
-        QString					m_netAuthUser;
-        QString					m_netAuthPass;
-        QUrl					m_netBaseApiUrl;
         QVariantMap				m_netDataMap;
+        MXEncodedPairList		m_netNextHeaders;
+        QSet<QNetworkReply*>	m_netReplies;
+        QHash<QNetworkReply*, QFutureInterface<Response> >	m_netFutures;
+        QPointer<MXRequestRecorder>	m_recorder;
+        QPointer<MXRequestMetrics>	m_metrics;
+        QHash<QNetworkReply*, Progress>	m_netProgress;
+        Progress				m_looseProgress;	// Of progress not coming from our replies
+        QTimer					m_progressTimer;	// Delivers the coalesced progress signals
+        QHash<QNetworkReply*, Route>	m_netRoutes;
+        int						m_netNextEndpoint;	// Picked by nextApiUrl(), -1 if none
+        QHash<QNetworkReply*, Deadline>		m_netDeadlines;
+        QHash<QNetworkReply*, Interruption>	m_netInterruptions;	// Aborted, not finished yet
+        int						m_netNextTimeout;		// -1: default timeout
+        int						m_netNextIdleTimeout;	// -1: default idle timeout
+        Interruption			m_lastInterruption;
+
+        /**
+         * Get the base URL of the next request, picked from the endpoint pool if any.
+         *
+         * @param		void
+         * @return		QUrl	Base API URL
+         */
+        QUrl	nextApiUrl(void);
+
+        /**
+         * Sends a copy of a GET to another endpoint, if it's still running.
+         *
+         * @param[in]	primary	Reply of the original request
+         * @return		void
+         */
+        void	hedge(QNetworkReply *primary);
+
+        /**
+         * Releases the endpoint of a finished reply and settles its race
+         * with a hedged copy, if any.
+         *
+         * @param[in]	reply	Finished reply
+         * @return		bool	FALSE if the reply failed and its copy takes over
+         */
+        bool	settleRoute(QNetworkReply *reply);
+
+        /**
+         * Forgets a reply without treating it.
+         *
+         * @param[in]	reply	Reply to drop
+         * @param[in]	abort	TRUE to abort it first
+         * @return		void
+         */
+        void	dropReply(QNetworkReply *reply, bool abort);
+
+        /**
+         * Watches the timeouts of a reply.
+         *
+         * @param[in]	reply		Reply to watch
+         * @param[in]	deadline	Its timeouts, the timer is created here
+         * @return		void
+         */
+        void	addDeadline(QNetworkReply *reply, Deadline deadline);
+
+        /**
+         * Arms the timer of a reply for its nearest expiry.
+         *
+         * @param[in]	reply	Reply with a deadline
+         * @return		void
+         */
+        void	armDeadline(QNetworkReply *reply);
+
+        /**
+         * Aborts a reply (and its hedged copy) and frees it, reporting why
+         * through requestFinished().
+         *
+         * @param[in]	reply	Reply to stop
+         * @param[in]	why		Cause reported to the caller
+         * @return		void
+         */
+        void	interrupt(QNetworkReply *reply, Interruption why);
+
+        /**
+         * Get the progress of a reply, or m_looseProgress if it isn't ours.
+         */
+        Progress&	progressOf(QNetworkReply *reply);
+
+        /**
+         * Tells whether a progress signal of a reply is due, given the progress
+         * interval. If not, it is marked pending and the progress timer is armed.
+         *
+         * @param[in]	reply		Reply, NULL if unknown
+         * @param[in]	download	TRUE for the download progress, FALSE for upload
+         * @return		bool		TRUE if the signal must be emitted now
+         */
+        bool	progressDue(QNetworkReply *reply, bool download);
+
+        /**
+         * Emits the last progress of a reply, with the summed progress,
+         * and restarts its clock.
+         *
+         * @param[in]	reply		Reply, NULL if unknown
+         * @param[in]	download	TRUE for the download progress, FALSE for upload
+         * @return		void
+         */
+        void	emitProgress(QNetworkReply *reply, bool download);
+
+        /**
+         * Sums the last progress of every request in progress.
+         * Left untouched if no request is tracked.
+         *
+         * @param[in]	download	TRUE for the download progress, FALSE for upload
+         * @param[out]	done		Bytes transferred
+         * @param[out]	total		Bytes to transfer, -1 if unknown
+         * @return		void
+         */
+        void	sumProgress(bool download, qint64 *done, qint64 *total) const;
+
+        /**
+         * Creates a fresh transport, configured once for all the copies using it.
+         *
+         * @param		void
+         * @return		QSharedPointer	New transport
+         */
+        static QSharedPointer<QNetworkAccessManager>	createTransport(void);
+
+        /**
+         * Connects the shared transport to this manager.
+         * Called by every constructor.
+         *
+         * @param		void
+         * @return		void
+         */
+        void	init(void);
+
+        /**
+         * Connects a reply sent by this manager to its slots.
+         *
+         * @param[in]	reply	Reply to watch
+         * @return		void
+         */
+        void	watchReply(QNetworkReply *reply);
+
+        /**
+         * Moves the state and the in-flight replies of another manager to this one.
+         *
+         * @param[in]	other	Manager to take from, left empty but valid
+         * @return		void
+         */
+        void	take(MXRequestManager& other);
+
+        /**
+         * Resets the internal QNetworkRequest to the default headers,
+         * sets its URL and applies the headers set for this request only.
+         *
+         * @param[in]	url		Full URL of the request
+         * @return		void
+         */
+        void	prepareRequest(QUrl const& url);
+
+        /**
+         * Forgets the headers and timeouts set for the next request.
+         * Called when a request can't be sent, so they don't apply to the next one.
+         *
+         * @param		void
+         * @return		bool	FALSE, for the caller to return
+         */
+        bool	discardNext(void);
+
+        /**
+         * Sends an already encoded body with its Content-Type.
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		Name of the HTTP method.
+         * @param[in]	body		Encoded body
+         * @param[in]	contentType	Content-Type of the body
+         * @return		bool		Returns the status of request. FALSE == no signal.
+         */
+        bool	requestEncoded(QString const& resource, QString const& method,
+                               QByteArray const& body, QByteArray const& contentType);
+
+        /**
+         * Called right after m_netReply has been created by a request() overload.
+         * Connects the reply's progress signals and feeds the recorder and
+         * the metrics, if any.
+         *
+         * @param[in]	method			Name of the HTTP method.
+         * @param[in]	body			Body sent with the request.
+         * @param[in]	bodyCaptured	FALSE if the body came from a device and couldn't be kept.
+         * @param[in]	bodySize		Size of an uncaptured body, -1 if unknown.
+         * @return		void
+         */
+        void	startReply(QString const& method, QByteArray const& body,
+                           bool bodyCaptured = true, qint64 bodySize = -1);
+
+        /**
+         * Returns a future bound to the given reply, resolved by requestFinished().
+         * A NULL reply gives an already finished, failed future.
+         *
+         * @param[in]	reply	Reply to watch
+         * @return		QFuture	Future of the reply's Response
+         */
+        QFuture<Response>	futureFor(QNetworkReply *reply);
 
     public:
         // Contructors //
@@ -122,15 +447,25 @@ class MXRequestManager : public QNetworkAccessManager
                          QString authPass = QString(), QObject *parent = 0);
 
         /**
-         * Constructs the Request Manager from another one
-         * (will try to copy the values, not pointers)
+         * Constructs the Request Manager from another one.
+         * The configuration and the transport are shared, so this is cheap
+         * and reuses the warm connections of the other manager.
          *
          * @param[in]	other	An other MXRequestManager instance
          */
         MXRequestManager(MXRequestManager const& other);
 
         /**
-         * Destructs the internal attributes.
+         * Constructs the Request Manager by moving another one,
+         * including its in-flight requests.
+         *
+         * @param[in]	other	An other MXRequestManager instance, left empty
+         */
+        MXRequestManager(MXRequestManager&& other);
+
+        /**
+         * Destructs the internal attributes. Requests in flight are aborted,
+         * and their futures resolved with the Canceled interruption.
          */
         ~MXRequestManager();
         // --- //
@@ -138,11 +473,18 @@ class MXRequestManager : public QNetworkAccessManager
         // Copy constructor //
         /**
          * Assigns a constructed Request Manager from another one
-         * (will copy the pointers).
+         * (shares the configuration and the transport).
          *
          * @param[in]	other	An other MXRequestManager instance
          */
         MXRequestManager&	operator=(MXRequestManager const& other);
+
+        /**
+         * Move-assigns a constructed Request Manager from another one.
+         *
+         * @param[in]	other	An other MXRequestManager instance, left empty
+         */
+        MXRequestManager&	operator=(MXRequestManager&& other);
         // --- //
 
         // Static methods
@@ -197,6 +539,14 @@ class MXRequestManager : public QNetworkAccessManager
          */
         QString			userAgent(void) const;
 
+        /**
+         * Get the headers sent with every request
+         *
+         * @param[in]	void
+         * @return		MXEncodedMap	Constant reference to the default headers
+         */
+        MXEncodedMap const&	defaultHeaders(void) const;
+
         /**
          * Get last HTTP status code
          *
@@ -205,6 +555,14 @@ class MXRequestManager : public QNetworkAccessManager
          */
         int     lastHttpCode(void) const;
 
+        /**
+         * Get why the last request was stopped before its end, if it was
+         *
+         * @param       void
+         * @return      Interruption    NotInterrupted, unless canceled or timed out
+         */
+        Interruption	lastInterruption(void) const;
+
         /**
          * Get internal QNetworkRequest
          *
@@ -221,6 +579,76 @@ class MXRequestManager : public QNetworkAccessManager
          */
         QNetworkReply const&  networkReply(void);
 
+        /**
+         * Get the transport actually sending the requests.
+         * It is shared by every copy of this manager, and must only be used
+         * from the thread this manager lives in.
+         *
+         * @param       void
+         * @return      QNetworkAccessManager   Shared transport
+         */
+        QNetworkAccessManager	*transport(void) const;
+
+        /**
+         * Set the proxy of the shared transport, instead of MXProxyFactory.
+         * Applies to every copy of this manager.
+         *
+         * @param[in]	proxy	Proxy to use
+         * @return		void
+         */
+        void					setProxy(QNetworkProxy const& proxy);
+
+        /**
+         * Get the proxy of the shared transport
+         */
+        QNetworkProxy			proxy(void) const;
+
+        /**
+         * Set the proxy factory of the shared transport, which takes ownership.
+         * Applies to every copy of this manager.
+         */
+        void					setProxyFactory(QNetworkProxyFactory *factory);
+
+        /**
+         * Get the proxy factory of the shared transport (MXProxyFactory by default)
+         */
+        QNetworkProxyFactory	*proxyFactory(void) const;
+
+        /**
+         * Set the cookie jar of the shared transport, which takes ownership.
+         * Applies to every copy of this manager.
+         */
+        void					setCookieJar(QNetworkCookieJar *cookieJar);
+
+        /**
+         * Get the cookie jar of the shared transport
+         */
+        QNetworkCookieJar		*cookieJar(void) const;
+
+        /**
+         * Set the cache of the shared transport, which takes ownership.
+         * Applies to every copy of this manager.
+         */
+        void					setCache(QAbstractNetworkCache *cache);
+
+        /**
+         * Get the cache of the shared transport
+         */
+        QAbstractNetworkCache	*cache(void) const;
+
+# if	QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        /**
+         * Set the accessibility of the shared transport.
+         * Applies to every copy of this manager.
+         */
+        void					setNetworkAccessible(NetworkAccessibility accessible);
+
+        /**
+         * Get the accessibility of the shared transport
+         */
+        NetworkAccessibility	networkAccessible(void) const;
+# endif
+
         /**
          * Get internal received data
          *
@@ -237,6 +665,18 @@ class MXRequestManager : public QNetworkAccessManager
          */
         QVariantMap	const&	data(void) const;
 
+        /**
+         * Get a single value of the received data from its JSON Pointer
+         * (RFC 6901), e.g. "/self/HEADERS/User-Agent", without parsing the
+         * whole document. Cheaper than data() when only a few fields are needed
+         * from a large response. See MXJsonPointer.
+         *
+         * @param[in]	pointer		JSON Pointer of the value
+         * @param[out]	found		Set to TRUE if the value was found (Optional)
+         * @return		QVariant	Value, invalid if not found
+         */
+        QVariant	rawValue(QString const& pointer, bool *found = 0) const;
+
         /**
          * Set internal HTTP Auth User
          *
@@ -261,6 +701,51 @@ class MXRequestManager : public QNetworkAccessManager
          */
         void			setApiUrl(QUrl const& apiUrl);
 
+        /**
+         * Get the equivalent base API URLs
+         *
+         * @param[in]	void
+         * @return		QList	Base API URLs, or apiUrl() alone
+         */
+        QList<QUrl>		apiUrls(void) const;
+
+        /**
+         * Set several equivalent base API URLs. Each request is sent to one of
+         * them, picked by endpointPool(). apiUrl() returns the first one, and
+         * setApiUrl() goes back to a single URL.
+         *
+         * @param[in]	QList	Base API URLs
+         * @return		void
+         */
+        void			setApiUrls(QList<QUrl> const& apiUrls);
+
+        /**
+         * Get the pool balancing the requests between the base API URLs,
+         * to tune its strategy and ejection. Shared with the copies.
+         *
+         * @param[in]	void
+         * @return		MXEndpointPool	Pool, or NULL if there's a single base URL
+         */
+        MXEndpointPool	*endpointPool(void) const;
+
+        /**
+         * Get the latency percentile triggering a hedged GET
+         *
+         * @param[in]	void
+         * @return		double	Percentile, 0 if hedging is disabled
+         */
+        double			hedgePercentile(void) const;
+
+        /**
+         * Enable hedged GETs when several base API URLs are set: if a GET
+         * isn't answered within the given percentile of the recent latencies,
+         * a copy is sent to another endpoint and the first answer wins.
+         *
+         * @param[in]	percentile	e.g. 95, 0 to disable (default)
+         * @return		void
+         */
+        void			setHedgePercentile(double percentile);
+
         /**
          * Set internal User-Agent
          *
@@ -269,12 +754,133 @@ class MXRequestManager : public QNetworkAccessManager
          */
         void			setUserAgent(QString const& userAgent = QString());
 
+        /**
+         * Set a header sent with every request (Accept, Accept-Encoding, ...).
+         * Copies of this manager aren't affected.
+         *
+         * @param[in]	name	Header name
+         * @param[in]	value	Header value (Empty to remove the header)
+         * @return		void
+         */
+        void			setDefaultHeader(QByteArray const& name, QByteArray const& value);
+
+        /**
+         * Set a header for the next request only (tracing IDs, ...), overriding
+         * the default header with the same name. Cleared once the request is sent,
+         * or failed to be.
+         *
+         * @param[in]	name	Header name
+         * @param[in]	value	Header value
+         * @return		void
+         */
+        void			setRequestHeader(QByteArray const& name, QByteArray const& value);
+
         /**
          * Set the accepted content type.
          * It means if the Content-Type of the replies isn't the same,
          * the manager will consider a server-side script error.
          */
         void			setResponseType(SupportedContentTypes const& responseType);
+
+        /**
+         * Get the minimum time between two progress signals
+         *
+         * @param[in]	void
+         * @return		int		Interval in ms, 0 if every chunk is signaled
+         */
+        int				progressInterval(void) const;
+
+        /**
+         * Set the minimum time between two progress signals of a request
+         * (default 0: every network chunk). Progress signals in between are
+         * coalesced into one, delivered once the interval elapsed, and the
+         * last one of a transfer is always delivered.
+         *
+         * @param[in]	ms		Interval in ms, 100 gives at most 10 signals per second
+         * @return		void
+         */
+        void			setProgressInterval(int ms);
+
+        /**
+         * Get the default total timeout of the requests
+         *
+         * @param[in]	void
+         * @return		int		Timeout in ms, 0 if none
+         */
+        int				timeout(void) const;
+
+        /**
+         * Set the default total timeout of the requests (default 0: none).
+         * A request still running after it is aborted, and reported with
+         * the TimedOut interruption and QNetworkReply::TimeoutError.
+         *
+         * @param[in]	ms		Timeout in ms, from the time the request is sent
+         * @return		void
+         */
+        void			setTimeout(int ms);
+
+        /**
+         * Get the default idle timeout of the requests
+         *
+         * @param[in]	void
+         * @return		int		Timeout in ms, 0 if none
+         */
+        int				idleTimeout(void) const;
+
+        /**
+         * Set the default idle timeout of the requests (default 0: none).
+         * A request transferring nothing for that long is aborted, and
+         * reported with the IdleTimedOut interruption.
+         *
+         * @param[in]	ms		Timeout in ms, restarted at every progress
+         * @return		void
+         */
+        void			setIdleTimeout(int ms);
+
+        /**
+         * Set the timeouts of the next request only, overriding the defaults.
+         * Cleared once the request is sent, or failed to be. Its hedged copies, if any, share
+         * the same deadline.
+         *
+         * @param[in]	timeout		Total timeout in ms, 0 for none, -1 for the default
+         * @param[in]	idleTimeout	Idle timeout in ms, 0 for none, -1 for the default
+         * @return		void
+         */
+        void			setRequestTimeout(int timeout, int idleTimeout = -1);
+
+        /**
+         * Get the attached traffic recorder
+         *
+         * @param[in]	void
+         * @return		MXRequestRecorder	Attached recorder, or NULL
+         */
+        MXRequestRecorder	*recorder(void) const;
+
+        /**
+         * Attach a traffic recorder. Every request/response going through this
+         * manager will be appended to it. The recorder isn't owned.
+         *
+         * @param[in]	MXRequestRecorder	Recorder to attach, NULL to detach
+         * @return		void
+         */
+        void			setRecorder(MXRequestRecorder *recorder);
+
+        /**
+         * Get the attached metrics registry
+         *
+         * @param[in]	void
+         * @return		MXRequestMetrics	Attached registry, or NULL
+         */
+        MXRequestMetrics	*metrics(void) const;
+
+        /**
+         * Attach a metrics registry, which may be shared by several managers.
+         * The registry isn't owned.
+         *
+         * @param[in]	MXRequestMetrics	Registry to attach, NULL to detach
+         * @return		void
+         */
+        void			setMetrics(MXRequestMetrics *metrics);
         // --- //
 
         // Requests with MX TypeDefs
@@ -363,6 +969,94 @@ class MXRequestManager : public QNetworkAccessManager
         bool	request(QString const& resource, QString const& method,
                         QHttpMultiPart *data);
 
+        /**
+         * Process the request, with given resource, method and streamed
+         * multipart/form-data body. Content-Type and Content-Length are set
+         * from the body, which is opened if needed. If the body has no parent,
+         * it is reparented to the reply and deleted with it.
+         * The body's partProgress() is relayed through uploadPartProgress().
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		Name of the HTTP method (POST or PUT).
+         * @param[in]	data		Multipart body to send.
+         * @return		bool		Returns the status of request. FALSE == no signal.
+         */
+        bool	request(QString const& resource, QString const& method,
+                        MXMultiPartBody *data);
+
+        /**
+         * Process the request, with given resource, method and JSON object.
+         * The body is written as compact JSON, with Content-Type application/json.
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		Name of the HTTP method.
+         * @param[in]	data		JSON object to send.
+         * @return		bool		Returns the status of request. FALSE == no signal.
+         */
+        bool	request(QString const& resource, QString const& method,
+                        QJsonObject const& data);
+
+        /**
+         * @overload
+         * Same as above, with a JSON array.
+         */
+        bool	request(QString const& resource, QString const& method,
+                        QJsonArray const& data);
+
+# if		QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        /**
+         * Process the request, with given resource, method and CBOR map
+         * (Content-Type application/cbor).
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		Name of the HTTP method.
+         * @param[in]	data		CBOR map to send.
+         * @return		bool		Returns the status of request. FALSE == no signal.
+         */
+        bool	request(QString const& resource, QString const& method,
+                        QCborMap const& data);
+
+        /**
+         * @overload
+         * Same as above, with a CBOR array.
+         */
+        bool	request(QString const& resource, QString const& method,
+                        QCborArray const& data);
+# endif
+
+        /**
+         * Process the request, with given resource, method and Q_GADGET struct,
+         * sent as a compact JSON object made of its properties.
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		Name of the HTTP method.
+         * @param[in]	data		Q_GADGET struct to send.
+         * @return		bool		Returns the status of request. FALSE == no signal.
+         */
+        template <typename T, typename = typename T::QtGadgetHelper>
+        bool	request(QString const& resource, QString const& method, T const& data)
+        {
+            return (this->request(resource, method, toJsonObject(T::staticMetaObject, &data)));
+        }
+
+        /**
+         * Encodes a JSON value as a compact JSON body.
+         * Unlike QJsonDocument, scalars are accepted.
+         *
+         * @param[in]	value		Value to encode
+         * @return		QByteArray	Compact JSON
+         */
+        static QByteArray	toJsonBody(QJsonValue const& value);
+
+        /**
+         * Converts the readable properties of a Q_GADGET to a JSON object.
+         *
+         * @param[in]	metaObject	Meta object of the gadget
+         * @param[in]	gadget		Pointer to the gadget
+         * @return		QJsonObject	Properties as JSON object
+         */
+        static QJsonObject	toJsonObject(QMetaObject const& metaObject, void const *gadget);
+
         /**
          * Parse the response depending on the responseType set.
          *
@@ -372,6 +1066,55 @@ class MXRequestManager : public QNetworkAccessManager
         bool	parseResponse(QString const& contentType, QByteArray const& response);
         // ---
 
+        // Requests returning futures
+        /**
+         * Same as request(), but returns a QFuture resolved with the Response
+         * as soon as the reply is finished and parsed. Under Qt 6, continuations
+         * can be chained with QFuture::then(), and under C++20 the future can be
+         * co_await'ed directly.
+         * If request() refuses the call, the returned future is already finished
+         * with a failed Response.
+         *
+         * @param[in]	resource	Name of resource, will be appended to the API URL.
+         * @param[in]	method		Name of the HTTP method.
+         * @param[in]	data		Any data accepted by one of the request() overloads.
+         * @return		QFuture		Future of the Response
+         */
+        template <typename T>
+        QFuture<Response>	requestAsync(QString const& resource, QString const& method,
+                                         T const& data)
+        {
+            if (!this->request(resource, method, data))
+                return (this->futureFor(NULL));
+            return (this->futureFor(this->m_netReply));
+        }
+
+        /**
+         * @overload
+         * Same as requestAsync() with an empty MXMap.
+         */
+        QFuture<Response>	requestAsync(QString const& resource, QString const& method);
+
+        /**
+         * Cancels the request of a future returned by requestAsync(). Its
+         * connection is aborted and its buffers freed right away, and the
+         * future is resolved with the Canceled interruption.
+         * QFuture::cancel() alone doesn't stop the transfer.
+         *
+         * @param[in]	future	Future of the request
+         * @return		bool	FALSE if the request is already finished
+         */
+        bool	cancel(QFuture<Response> const& future);
+
+        /**
+         * Cancels every request in progress, whether it has a future or not.
+         *
+         * @param		void
+         * @return		void
+         */
+        void	cancelAll(void);
+        // ---
+
     signals:
         /**
          * Emitted when a request begins
@@ -404,6 +1147,23 @@ class MXRequestManager : public QNetworkAccessManager
          */
         void	uploadProgress(qint64 bytesReceived, qint64 bytesTotal);
 
+        /**
+         * Emitted when a part of an MXMultiPartBody is being uploaded
+         */
+        void	uploadPartProgress(int part, qint64 bytesSent, qint64 bytesTotal);
+
+        /**
+         * Emitted with downloadProgress, summed over the requests in progress.
+         * bytesTotal is -1 while any of them has an unknown size.
+         */
+        void	totalDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+
+        /**
+         * Emitted with uploadProgress, summed over the requests in progress.
+         * bytesTotal is -1 while any of them has an unknown size.
+         */
+        void	totalUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+
     public slots:
         /**
          * Called when there is an error with the request
@@ -432,6 +1192,76 @@ class MXRequestManager : public QNetworkAccessManager
          * Will fill the QAuthenticator object with internal authUser and authPass.
          */
         void	requestAuth(QNetworkReply *reply, QAuthenticator *auth);
+
+    private slots:
+        /**
+         * Called when a reply sent by this manager is finished.
+         * Forwards it to requestFinished().
+         */
+        void	replyFinished(void);
+
+        /**
+         * Called when an HTTPS reply sent by this manager is encrypted.
+         * Keeps its TLS session ticket in MXSessionCache.
+         */
+        void	replyEncrypted(void);
+
+        /**
+         * Called when the deadline timer of a reply fires.
+         * Interrupts the reply if one of its timeouts really elapsed.
+         */
+        void	deadlineExpired(void);
+
+        /**
+         * Called when the progress timer fires.
+         * Emits the pending progress signals whose interval elapsed, and
+         * re-arms the timer for the others.
+         */
+        void	progressTimeout(void);
+};
+
+# if		defined(__cpp_impl_coroutine) && defined(__has_include)
+#  if		__has_include(<coroutine>)
+#	include	<coroutine>
+#	include	<QFutureWatcher>
+
+/**
+ * @struct	MXResponseAwaiter
+ * @brief	C++20 awaiter over a QFuture<MXRequestManager::Response>.
+ *			The coroutine is resumed from the event loop of the awaiting thread.
+ */
+struct MXResponseAwaiter
+{
+    QFuture<MXRequestManager::Response>	future;
+
+    bool	await_ready(void) const
+    {
+        return (this->future.isFinished());
+    }
+
+    void	await_suspend(std::coroutine_handle<> handle)
+    {
+        QFutureWatcher<MXRequestManager::Response>	*watcher;
+
+        watcher = new QFutureWatcher<MXRequestManager::Response>;
+        QObject::connect(watcher, &QFutureWatcherBase::finished, [watcher, handle]() {
+            watcher->deleteLater();
+            handle.resume();
+        });
+        watcher->setFuture(this->future);
+    }
+
+    MXRequestManager::Response	await_resume(void) const
+    {
+        return (this->future.result());
+    }
 };
 
+inline MXResponseAwaiter	operator co_await(QFuture<MXRequestManager::Response> future)
+{
+    return (MXResponseAwaiter{future});
+}
+#  endif
+# endif
+
 #endif // MXREQUESTMANAGER_HPP
@@ -0,0 +1,238 @@
+/**
+ * @file		MXRequestMetrics.cpp
+ * @brief		MXRequestMetrics
+ *
+ * @details		Aggregate request metrics, exportable as Prometheus text
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QMapIterator>
+#include <QMetaEnum>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include "MXRequestMetrics.hpp"
+
+// Constructors
+MXRequestMetrics::MXRequestMetrics(QObject *parent)
+    : QObject(parent), m_maxEndpoints(64)
+{
+}
+// ---
+
+// Getters / Setters
+void	MXRequestMetrics::setMaxEndpoints(int count)
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    this->m_maxEndpoints = count;
+}
+
+MXRequestMetrics::Snapshot	MXRequestMetrics::snapshot(void) const
+{
+    QMutexLocker	lock(&this->m_mutex);
+
+    return (this->m_data);
+}
+// ---
+
+// Treatments
+void	MXRequestMetrics::recordRequest(QNetworkReply *reply, QString const& method,
+                                        QUrl const& url, qint64 bytesSent)
+{
+    Pending	pending;
+
+    if (reply == NULL)
+        return;
+
+    pending.endpoint = method.toUpper() + ' '
+                       + (url.path().isEmpty() ? "/" : normalizedPath(url.path()));
+    pending.bytesSent = bytesSent;
+    pending.timer.start();
+
+    QMutexLocker	lock(&this->m_mutex);
+
+    this->m_pending.insert(reply, pending);
+    ++this->m_data.inFlight;
+}
+
+void	MXRequestMetrics::recordResponse(QNetworkReply *reply, int httpCode,
+                                         qint64 bytesReceived, bool parsed)
+{
+    QMutexLocker	lock(&this->m_mutex);
+    Pending			pending;
+    Endpoint		*endpoint;
+
+    if (!this->m_pending.contains(reply))
+        return;
+    pending = this->m_pending.take(reply);
+    --this->m_data.inFlight;
+
+    if (!this->m_data.endpoints.contains(pending.endpoint)
+        && this->m_data.endpoints.size() >= this->m_maxEndpoints)
+        pending.endpoint = "other";
+    endpoint = &this->m_data.endpoints[pending.endpoint];
+
+    ++endpoint->requests;
+    if (reply->error() != QNetworkReply::NoError || httpCode >= 400)
+        ++endpoint->errors;
+    if (pending.bytesSent > 0)
+        endpoint->bytesSent += quint64(pending.bytesSent);
+    if (bytesReceived > 0)
+        endpoint->bytesReceived += quint64(bytesReceived);
+    endpoint->latency.record(quint64(pending.timer.nsecsElapsed() / 1000));
+
+    ++this->m_data.httpCodes[httpCode];
+    if (reply->error() != QNetworkReply::NoError)
+        ++this->m_data.networkErrors[int(reply->error())];
+    if (!parsed)
+        ++this->m_data.parseFailures;
+}
+
+void	MXRequestMetrics::reset(void)
+{
+    QMutexLocker	lock(&this->m_mutex);
+    qint64			inFlight = this->m_data.inFlight;
+
+    this->m_data = Snapshot();
+    this->m_data.inFlight = inFlight;
+}
+
+QString	MXRequestMetrics::normalizedPath(QString const& path)
+{
+    static QRegularExpression const	number("^[0-9]+$");
+    static QRegularExpression const	uuid("^\\{?[0-9a-fA-F]{8}(-[0-9a-fA-F]{4}){3}"
+                                          "-[0-9a-fA-F]{12}\\}?$");
+    QStringList						segments = path.split('/');
+    int								i = -1;
+
+    while (++i < segments.size())
+        if (number.match(segments.at(i)).hasMatch())
+            segments[i] = ":id";
+        else if (uuid.match(segments.at(i)).hasMatch())
+            segments[i] = ":uuid";
+    return (segments.join('/'));
+}
+// ---
+
+// Export
+QByteArray	MXRequestMetrics::escape(QString const& label)
+{
+    return (QString(label).replace('\\', "\\\\").replace('"', "\\\"")
+            .replace('\n', "\\n").toUtf8());
+}
+
+QByteArray	MXRequestMetrics::toPrometheus(QString const& prefix) const
+{
+    static double const	bounds[] = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                     0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+    QMetaEnum			errors = QNetworkReply::staticMetaObject.enumerator(
+                             QNetworkReply::staticMetaObject.indexOfEnumerator("NetworkError"));
+    Snapshot			data = this->snapshot();
+    QByteArray			name = prefix.toUtf8();
+    QByteArray			out;
+    unsigned			b;
+
+    QMapIterator<QString, Endpoint>	e(data.endpoints);
+    QMapIterator<int, quint64>		i(data.httpCodes);
+
+    out += "# TYPE " + name + "_requests_total counter\n";
+    while (e.hasNext())
+    {
+        e.next();
+        out += name + "_requests_total{endpoint=\"" + escape(e.key()) + "\"} "
+               + QByteArray::number(e.value().requests) + '\n';
+    }
+
+    out += "# TYPE " + name + "_errors_total counter\n";
+    e.toFront();
+    while (e.hasNext())
+    {
+        e.next();
+        out += name + "_errors_total{endpoint=\"" + escape(e.key()) + "\"} "
+               + QByteArray::number(e.value().errors) + '\n';
+    }
+
+    out += "# TYPE " + name + "_sent_bytes_total counter\n";
+    e.toFront();
+    while (e.hasNext())
+    {
+        e.next();
+        out += name + "_sent_bytes_total{endpoint=\"" + escape(e.key()) + "\"} "
+               + QByteArray::number(e.value().bytesSent) + '\n';
+    }
+
+    out += "# TYPE " + name + "_received_bytes_total counter\n";
+    e.toFront();
+    while (e.hasNext())
+    {
+        e.next();
+        out += name + "_received_bytes_total{endpoint=\"" + escape(e.key()) + "\"} "
+               + QByteArray::number(e.value().bytesReceived) + '\n';
+    }
+
+    out += "# TYPE " + name + "_in_flight gauge\n";
+    out += name + "_in_flight " + QByteArray::number(data.inFlight) + '\n';
+
+    out += "# TYPE " + name + "_parse_failures_total counter\n";
+    out += name + "_parse_failures_total " + QByteArray::number(data.parseFailures) + '\n';
+
+    out += "# TYPE " + name + "_http_responses_total counter\n";
+    while (i.hasNext())
+    {
+        i.next();
+        out += name + "_http_responses_total{code=\"" + QByteArray::number(i.key()) + "\"} "
+               + QByteArray::number(i.value()) + '\n';
+    }
+
+    out += "# TYPE " + name + "_network_errors_total counter\n";
+    i = data.networkErrors;
+    while (i.hasNext())
+    {
+        i.next();
+        out += name + "_network_errors_total{error=\""
+               + QByteArray(errors.valueToKey(i.key())) + "\"} "
+               + QByteArray::number(i.value()) + '\n';
+    }
+
+    out += "# TYPE " + name + "_duration_seconds histogram\n";
+    e.toFront();
+    while (e.hasNext())
+    {
+        e.next();
+
+        QByteArray const			label = escape(e.key());
+        MXLatencyHistogram const&	latency = e.value().latency;
+
+        // Bounds on the bucket boundaries: no bucket straddles them
+        for (b = 0; b < sizeof(bounds) / sizeof(*bounds); ++b)
+        {
+            quint64	bound = MXLatencyHistogram::bucketCeiling(quint64(bounds[b] * 1e6));
+
+            out += name + "_duration_seconds_bucket{endpoint=\"" + label + "\",le=\""
+                   + QByteArray::number(double(bound) / 1e6, 'f', 6) + "\"} "
+                   + QByteArray::number(latency.countAtOrBelow(bound)) + '\n';
+        }
+        out += name + "_duration_seconds_bucket{endpoint=\"" + label + "\",le=\"+Inf\"} "
+               + QByteArray::number(latency.count()) + '\n';
+        out += name + "_duration_seconds_sum{endpoint=\"" + label + "\"} "
+               + QByteArray::number(double(latency.sum()) / 1e6, 'f', 6) + '\n';
+        out += name + "_duration_seconds_count{endpoint=\"" + label + "\"} "
+               + QByteArray::number(latency.count()) + '\n';
+    }
+    return (out);
+}
+// ---
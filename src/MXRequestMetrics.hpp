@@ -0,0 +1,164 @@
+/**
+ * @brief		MXRequestMetrics
+ *
+ * @details		Aggregate request metrics, exportable as Prometheus text
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXREQUESTMETRICS_HPP
+# define	MXREQUESTMETRICS_HPP
+
+# include	<QByteArray>
+# include	<QElapsedTimer>
+# include	<QHash>
+# include	<QMap>
+# include	<QMutex>
+# include	<QObject>
+# include	<QString>
+// QtNetwork
+# include	<QtNetwork/QNetworkReply>
+// ---
+# include	<QUrl>
+
+# include	"MXLatencyHistogram.hpp"
+
+/**
+ * @class	MXRequestMetrics
+ * @brief	Counts the requests of the attached managers
+ * @extends	QObject
+ *
+ * Requests are grouped by endpoint ("METHOD /path", without the query).
+ * Numeric and UUID path segments are replaced by ":id" and ":uuid", so
+ * "/users/42" and "/users/43" are one endpoint.
+ * The "le" bounds of the exported latency buckets are the histogram's bucket
+ * boundaries closest above 1 ms, 2.5 ms, ... 10 s (at most ~3% above), so
+ * their counts are exact.
+ * Recording takes one short lock, so a registry can be shared by managers
+ * living in different threads and left on in production.
+ * Latencies are recorded in microseconds.
+ */
+
+class MXRequestMetrics : public QObject
+{
+    Q_OBJECT
+
+    public:
+        /**
+        * @struct
+        */
+        struct Endpoint
+        {
+            quint64				requests;		// Finished requests
+            quint64				errors;			// Network errors or HTTP codes >= 400
+            quint64				bytesSent;		// Bodies of known size only
+            quint64				bytesReceived;
+            MXLatencyHistogram	latency;
+
+            Endpoint(void) : requests(0), errors(0), bytesSent(0), bytesReceived(0) {}
+        };
+
+        /**
+        * @struct
+        */
+        struct Snapshot
+        {
+            qint64					inFlight;
+            quint64					parseFailures;
+            QMap<int, quint64>		httpCodes;		// By HTTP status, 0 if none
+            QMap<int, quint64>		networkErrors;	// By QNetworkReply::NetworkError
+            QMap<QString, Endpoint>	endpoints;
+
+            Snapshot(void) : inFlight(0), parseFailures(0) {}
+        };
+
+    private:
+        struct Pending
+        {
+            QString			endpoint;
+            qint64			bytesSent;
+            QElapsedTimer	timer;
+        };
+
+        mutable QMutex					m_mutex;
+        int								m_maxEndpoints;
+        Snapshot						m_data;
+        QHash<QNetworkReply*, Pending>	m_pending;
+
+        static QByteArray	escape(QString const& label);
+
+        /**
+         * Replaces the numeric and UUID segments of a path by ":id" and ":uuid".
+         */
+        static QString		normalizedPath(QString const& path);
+
+    public:
+        /**
+         * Constructs an empty registry
+         */
+        MXRequestMetrics(QObject *parent = 0);
+
+        /**
+         * Set the maximum number of endpoints tracked separately (default 64).
+         * Further endpoints are counted under "other", bounding the memory.
+         *
+         * @param[in]	count	Number of endpoints
+         * @return		void
+         */
+        void		setMaxEndpoints(int count);
+
+        /**
+         * Called by MXRequestManager when a request is sent.
+         *
+         * @param[in]	reply		Reply of the request
+         * @param[in]	method		Name of the HTTP method
+         * @param[in]	url			URL of the request
+         * @param[in]	bytesSent	Size of the body, -1 if unknown
+         * @return		void
+         */
+        void		recordRequest(QNetworkReply *reply, QString const& method,
+                                  QUrl const& url, qint64 bytesSent);
+
+        /**
+         * Called by MXRequestManager when a request is finished or dropped.
+         *
+         * @param[in]	reply			Reply of the request
+         * @param[in]	httpCode		HTTP status code, 0 if none
+         * @param[in]	bytesReceived	Size of the response body
+         * @param[in]	parsed			FALSE if the response couldn't be parsed
+         * @return		void
+         */
+        void		recordResponse(QNetworkReply *reply, int httpCode,
+                                   qint64 bytesReceived, bool parsed);
+
+        /**
+         * Get a consistent copy of every metric
+         */
+        Snapshot	snapshot(void) const;
+
+        /**
+         * Resets every counter. Requests in flight are still tracked.
+         */
+        void		reset(void);
+
+        /**
+         * Exports the metrics in the Prometheus text format (version 0.0.4).
+         *
+         * @param[in]	prefix		Prefix of the metric names
+         * @return		QByteArray	Exposition text
+         */
+        QByteArray	toPrometheus(QString const& prefix = "mxrequest") const;
+};
+
+#endif // MXREQUESTMETRICS_HPP
@@ -0,0 +1,226 @@
+/**
+ * @file		MXRequestRecorder.cpp
+ * @brief		MXRequestRecorder
+ *
+ * @details		Traffic capture for MXRequestManager
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include "MXRequestRecorder.hpp"
+
+// Serialization
+QDataStream&	operator<<(QDataStream& stream, MXRequestRecord const& record)
+{
+    stream << record.offset << record.method << record.url
+           << record.requestHeaders << record.requestBody << record.requestBodyCaptured
+           << qint32(record.httpCode) << record.responseHeaders << record.responseBody
+           << record.duration;
+    return (stream);
+}
+
+QDataStream&	operator>>(QDataStream& stream, MXRequestRecord& record)
+{
+    qint32	httpCode;
+
+    stream >> record.offset >> record.method >> record.url
+           >> record.requestHeaders >> record.requestBody >> record.requestBodyCaptured
+           >> httpCode >> record.responseHeaders >> record.responseBody
+           >> record.duration;
+    record.httpCode = httpCode;
+    return (stream);
+}
+// ---
+
+// Constructors
+MXRequestRecorder::MXRequestRecorder(QString const& fileName, QObject *parent)
+    : QObject(parent), m_recordResponseBodies(true), m_file(fileName)
+{
+}
+
+MXRequestRecorder::~MXRequestRecorder()
+{
+    this->close();
+}
+// ---
+
+// Getters / Setters
+bool	MXRequestRecorder::isOpen(void) const
+{
+    return (this->m_file.isOpen());
+}
+
+void	MXRequestRecorder::setRecordResponseBodies(bool record)
+{
+    this->m_recordResponseBodies = record;
+}
+// ---
+
+// Treatments
+bool	MXRequestRecorder::open(void)
+{
+    if (this->m_file.isOpen())
+        return (true);
+    if (!this->m_file.open(QIODevice::ReadWrite))
+        return (false);
+
+    QDataStream	stream(&this->m_file);
+    quint32		magic;
+    quint32		version;
+    qint64		valid;
+
+    stream.setVersion(QDataStream::Qt_5_0);
+    if (this->m_file.size() == 0)
+        stream << quint32(MXREQUESTRECORDER_MAGIC) << quint32(MXREQUESTRECORDER_VERSION);
+    else
+    {
+        stream >> magic >> version;
+        if (magic != MXREQUESTRECORDER_MAGIC || version != MXREQUESTRECORDER_VERSION)
+        {
+            this->m_file.close();
+            return (false);
+        }
+
+        valid = this->m_file.pos();
+        while (!stream.atEnd())
+        {
+            QByteArray	block;
+
+            stream >> block;
+            if (stream.status() != QDataStream::Ok)
+                break;
+            valid = this->m_file.pos();
+        }
+
+        // A record cut by a crash would hide the ones appended after it
+        if (valid < this->m_file.size())
+            this->m_file.resize(valid);
+        this->m_file.seek(valid);
+    }
+    this->m_clock.start();
+    return (true);
+}
+
+void	MXRequestRecorder::close(void)
+{
+    this->m_pending.clear();
+    if (this->m_file.isOpen())
+    {
+        this->m_file.flush();
+        this->m_file.close();
+    }
+}
+
+void	MXRequestRecorder::recordRequest(QNetworkReply *reply, QString const& method,
+                                         QNetworkRequest const& request,
+                                         QByteArray const& body, bool bodyCaptured)
+{
+    if (!this->m_file.isOpen() || reply == NULL)
+        return;
+
+    Pending		pending;
+    QByteArray	header;
+
+    pending.record.offset = this->m_clock.elapsed();
+    pending.record.method = method;
+    pending.record.url = request.url();
+    foreach (header, request.rawHeaderList())
+        pending.record.requestHeaders.append(QNetworkReply::RawHeaderPair(header,
+                                                                          request.rawHeader(header)));
+    pending.record.requestBody = body;
+    pending.record.requestBodyCaptured = bodyCaptured;
+    pending.timer.start();
+    this->m_pending.insert(reply, pending);
+}
+
+void	MXRequestRecorder::recordResponse(QNetworkReply *reply, int httpCode,
+                                          QByteArray const& body)
+{
+    if (!this->m_file.isOpen() || !this->m_pending.contains(reply))
+        return;
+
+    Pending		pending = this->m_pending.take(reply);
+    QByteArray	block;
+    QDataStream	blockStream(&block, QIODevice::WriteOnly);
+    QDataStream	stream(&this->m_file);
+
+    pending.record.httpCode = httpCode;
+    pending.record.responseHeaders = reply->rawHeaderPairs();
+    if (this->m_recordResponseBodies)
+        pending.record.responseBody = body;
+    pending.record.duration = pending.timer.elapsed();
+
+    blockStream.setVersion(QDataStream::Qt_5_0);
+    stream.setVersion(QDataStream::Qt_5_0);
+    blockStream << pending.record;
+    stream << block;
+}
+
+void	MXRequestRecorder::moveRequest(QNetworkReply *from, QNetworkReply *to)
+{
+    if (to == NULL || !this->m_pending.contains(from) || this->m_pending.contains(to))
+        return;
+
+    Pending	pending = this->m_pending.take(from);
+
+    pending.record.url = to->url(); // The endpoint answering it
+    this->m_pending.insert(to, pending);
+}
+
+void	MXRequestRecorder::discardRequest(QNetworkReply *reply)
+{
+    this->m_pending.remove(reply);
+}
+
+QList<MXRequestRecord>	MXRequestRecorder::readAll(QString const& fileName, bool *ok)
+{
+    QList<MXRequestRecord>	records;
+    QFile					file(fileName);
+    QDataStream				stream(&file);
+    quint32					magic;
+    quint32					version;
+
+    if (ok)
+        *ok = false;
+    if (!file.open(QIODevice::ReadOnly))
+        return (records);
+
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream >> magic >> version;
+    if (magic != MXREQUESTRECORDER_MAGIC || version != MXREQUESTRECORDER_VERSION)
+        return (records);
+
+    while (!stream.atEnd())
+    {
+        QByteArray		block;
+        MXRequestRecord	record;
+
+        stream >> block;
+        if (stream.status() != QDataStream::Ok)
+            break; // Truncated last record
+
+        QDataStream	blockStream(block);
+
+        blockStream.setVersion(QDataStream::Qt_5_0);
+        blockStream >> record;
+        if (blockStream.status() != QDataStream::Ok)
+            break;
+        records.append(record);
+    }
+
+    if (ok)
+        *ok = true;
+    return (records);
+}
+// ---
@@ -0,0 +1,194 @@
+/**
+ * @brief		MXRequestRecorder
+ *
+ * @details		Traffic capture for MXRequestManager
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXREQUESTRECORDER_HPP
+# define	MXREQUESTRECORDER_HPP
+
+# include	<QByteArray>
+# include	<QDataStream>
+# include	<QElapsedTimer>
+# include	<QFile>
+# include	<QHash>
+# include	<QList>
+# include	<QObject>
+# include	<QString>
+// QtNetwork
+# include	<QtNetwork/QNetworkReply>
+# include	<QtNetwork/QNetworkRequest>
+// ---
+# include	<QUrl>
+
+# define	MXREQUESTRECORDER_MAGIC		0x4d585252 // "MXRR"
+# define	MXREQUESTRECORDER_VERSION	1
+
+/**
+ * @struct	MXRequestRecord
+ * @brief	One captured request and its response
+ */
+struct MXRequestRecord
+{
+    qint64								offset;			// ms since the recorder was opened
+    QString								method;
+    QUrl								url;
+    QList<QNetworkReply::RawHeaderPair>	requestHeaders;
+    QByteArray							requestBody;
+    bool								requestBodyCaptured;
+    int									httpCode;
+    QList<QNetworkReply::RawHeaderPair>	responseHeaders;
+    QByteArray							responseBody;
+    qint64								duration;		// ms between send and finish
+
+    MXRequestRecord(void)
+        : offset(0), requestBodyCaptured(true), httpCode(0), duration(0) {}
+};
+
+QDataStream&	operator<<(QDataStream& stream, MXRequestRecord const& record);
+QDataStream&	operator>>(QDataStream& stream, MXRequestRecord& record);
+
+/**
+ * @class	MXRequestRecorder
+ * @brief	Appends every request/response of the attached managers to a file
+ * @extends	QObject
+ *
+ * The file is a small header (magic, version) followed by length-prefixed
+ * QDataStream records, so it can be appended to by several sessions.
+ * A truncated last record is ignored when reading, and cut by the next open()
+ * so the sessions appended after it can be read.
+ */
+
+class MXRequestRecorder : public QObject
+{
+    Q_OBJECT
+
+    private:
+        struct Pending
+        {
+            MXRequestRecord	record;
+            QElapsedTimer	timer;
+        };
+
+        bool							m_recordResponseBodies;
+        QElapsedTimer					m_clock;
+        QFile							m_file;
+        QHash<QNetworkReply*, Pending>	m_pending;
+
+    public:
+        /**
+         * Constructs a recorder writing to the given file.
+         * Nothing is written until open() succeeds.
+         *
+         * @param[in]	fileName	Capture file, created if needed
+         */
+        MXRequestRecorder(QString const& fileName, QObject *parent = 0);
+
+        /**
+         * Closes the capture file.
+         */
+        ~MXRequestRecorder();
+
+        /**
+         * Opens the capture file in append mode, writing the header if empty
+         * and dropping a truncated last record.
+         *
+         * @param		void
+         * @return		bool	FALSE if the file can't be opened or isn't a capture file
+         */
+        bool	open(void);
+
+        /**
+         * Flushes and closes the capture file. Pending requests are dropped.
+         *
+         * @param		void
+         * @return		void
+         */
+        void	close(void);
+
+        /**
+         * Get the capture state
+         *
+         * @param		void
+         * @return		bool	TRUE if the capture file is open
+         */
+        bool	isOpen(void) const;
+
+        /**
+         * Set whether response bodies are kept (default) or dropped,
+         * for more compact captures when only the request mix matters.
+         *
+         * @param[in]	bool	Keep response bodies
+         * @return		void
+         */
+        void	setRecordResponseBodies(bool record);
+
+        /**
+         * Called by MXRequestManager when a request is sent.
+         *
+         * @param[in]	reply			Reply of the request
+         * @param[in]	method			Name of the HTTP method
+         * @param[in]	request			Request as sent
+         * @param[in]	body			Body as sent
+         * @param[in]	bodyCaptured	FALSE if the body couldn't be captured
+         * @return		void
+         */
+        void	recordRequest(QNetworkReply *reply, QString const& method,
+                              QNetworkRequest const& request, QByteArray const& body,
+                              bool bodyCaptured);
+
+        /**
+         * Called by MXRequestManager when a request is finished.
+         * Appends the complete record to the capture file.
+         *
+         * @param[in]	reply		Reply of the request
+         * @param[in]	httpCode	HTTP status code
+         * @param[in]	body		Response body
+         * @return		void
+         */
+        void	recordResponse(QNetworkReply *reply, int httpCode, QByteArray const& body);
+
+        /**
+         * Called by MXRequestManager when a hedged copy takes over a request.
+         * The pending record follows the reply answering it, and keeps its
+         * start time. Nothing is done if the copy already has a record.
+         *
+         * @param[in]	from	Reply given up
+         * @param[in]	to		Reply taking over
+         * @return		void
+         */
+        void	moveRequest(QNetworkReply *from, QNetworkReply *to);
+
+        /**
+         * Called by MXRequestManager when a reply is dropped without answer.
+         * Its pending record is forgotten.
+         *
+         * @param[in]	reply	Reply dropped
+         * @return		void
+         */
+        void	discardRequest(QNetworkReply *reply);
+
+        /**
+         * Reads every complete record of a capture file.
+         *
+         * @param[in]	fileName	Capture file
+         * @param[out]	ok			Set to FALSE if the file can't be read (Optional)
+         * @return		QList		Records, in capture order
+         */
+        static QList<MXRequestRecord>	readAll(QString const& fileName, bool *ok = 0);
+};
+
+#endif // MXREQUESTRECORDER_HPP
@@ -0,0 +1,161 @@
+/**
+ * @file		MXRequestReplayer.cpp
+ * @brief		MXRequestReplayer
+ *
+ * @details		Timed replay of traffic captured by MXRequestRecorder
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QFutureWatcher>
+
+#include "MXRequestReplayer.hpp"
+
+// Constructors
+MXRequestReplayer::MXRequestReplayer(MXRequestManager *manager, QObject *parent)
+    : QObject(parent), m_next(0), m_outstanding(0), m_succeeded(0), m_failed(0),
+      m_speed(1.0), m_manager(manager)
+{
+    this->m_timer.setSingleShot(true);
+    connect(&this->m_timer, SIGNAL(timeout()), SLOT(sendDue()));
+}
+// ---
+
+// Getters / Setters
+bool	MXRequestReplayer::load(QString const& fileName)
+{
+    bool	ok;
+
+    this->setRecords(MXRequestRecorder::readAll(fileName, &ok));
+    return (ok);
+}
+
+void	MXRequestReplayer::setRecords(QList<MXRequestRecord> const& records)
+{
+    this->m_records = records;
+}
+
+QList<MXRequestRecord> const&	MXRequestReplayer::records(void) const
+{
+    return (this->m_records);
+}
+
+void	MXRequestReplayer::setSpeed(qreal speed)
+{
+    this->m_speed = speed;
+}
+
+qreal	MXRequestReplayer::speed(void) const
+{
+    return (this->m_speed);
+}
+
+bool	MXRequestReplayer::isRunning(void) const
+{
+    return (this->m_timer.isActive() || this->m_outstanding > 0);
+}
+
+int		MXRequestReplayer::succeeded(void) const
+{
+    return (this->m_succeeded);
+}
+
+int		MXRequestReplayer::failed(void) const
+{
+    return (this->m_failed);
+}
+// ---
+
+// Slots
+void	MXRequestReplayer::start(void)
+{
+    this->m_next = 0;
+    this->m_succeeded = 0;
+    this->m_failed = 0;
+    this->m_clock.start();
+    this->sendDue();
+}
+
+void	MXRequestReplayer::stop(void)
+{
+    bool	running = this->isRunning();
+
+    this->m_timer.stop();
+    this->m_next = this->m_records.size();
+    if (running && this->m_outstanding == 0)
+        emit this->finished();
+}
+
+void	MXRequestReplayer::sendDue(void)
+{
+    qint64	firstOffset;
+    qint64	due;
+
+    if (this->m_manager.isNull())
+        return;
+
+    firstOffset = this->m_records.isEmpty() ? 0 : this->m_records.first().offset;
+    while (this->m_next < this->m_records.size())
+    {
+        MXRequestRecord const&	record = this->m_records.at(this->m_next);
+        QString					resource = record.url.path();
+
+        if (this->m_speed > 0)
+        {
+            due = qint64((record.offset - firstOffset) / this->m_speed);
+            if (due > this->m_clock.elapsed())
+            {
+                this->m_timer.start(int(due - this->m_clock.elapsed()));
+                return;
+            }
+        }
+
+        if (record.url.hasQuery())
+            resource.append('?').append(record.url.query(QUrl::FullyEncoded));
+
+        QFutureWatcher<MXRequestManager::Response>	*watcher;
+        int											i = -1;
+
+        while (++i < record.requestHeaders.size())
+            if (record.requestHeaders.at(i).first.toLower() != "content-length")
+                this->m_manager->setRequestHeader(record.requestHeaders.at(i).first,
+                                                  record.requestHeaders.at(i).second);
+
+        watcher = new QFutureWatcher<MXRequestManager::Response>(this);
+        connect(watcher, SIGNAL(finished()), SLOT(replyFinished()));
+        ++this->m_outstanding;
+        ++this->m_next;
+        watcher->setFuture(this->m_manager->requestAsync(resource, record.method,
+                                                         record.requestBody));
+    }
+
+    if (this->m_outstanding == 0)
+        emit this->finished();
+}
+
+void	MXRequestReplayer::replyFinished(void)
+{
+    QFutureWatcher<MXRequestManager::Response>	*watcher;
+
+    watcher = static_cast<QFutureWatcher<MXRequestManager::Response>*>(this->sender());
+    if (watcher->result().ok)
+        ++this->m_succeeded;
+    else
+        ++this->m_failed;
+    watcher->deleteLater();
+
+    if (--this->m_outstanding == 0 && this->m_next >= this->m_records.size())
+        emit this->finished();
+}
+// ---
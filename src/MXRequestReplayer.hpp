@@ -0,0 +1,155 @@
+/**
+ * @brief		MXRequestReplayer
+ *
+ * @details		Timed replay of traffic captured by MXRequestRecorder
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXREQUESTREPLAYER_HPP
+# define	MXREQUESTREPLAYER_HPP
+
+# include	<QElapsedTimer>
+# include	<QList>
+# include	<QObject>
+# include	<QPointer>
+# include	<QString>
+# include	<QTimer>
+
+# include	"MXRequestManager.hpp"
+# include	"MXRequestRecorder.hpp"
+
+/**
+ * @class	MXRequestReplayer
+ * @brief	Re-issues captured traffic through an MXRequestManager
+ * @extends	QObject
+ *
+ * Records are sent to the manager's API URL (only the path and query of the
+ * captured URL are kept), so a capture from production can be replayed
+ * against a local stand-in server.
+ */
+
+class MXRequestReplayer : public QObject
+{
+    Q_OBJECT
+
+    private:
+        int							m_next;
+        int							m_outstanding;
+        int							m_succeeded;
+        int							m_failed;
+        qreal						m_speed;
+        QElapsedTimer				m_clock;
+        QList<MXRequestRecord>		m_records;
+        QPointer<MXRequestManager>	m_manager;
+        QTimer						m_timer;
+
+    public:
+        /**
+         * Constructs a replayer sending through the given manager.
+         *
+         * @param[in]	manager	Manager used to send the requests (not owned)
+         */
+        MXRequestReplayer(MXRequestManager *manager, QObject *parent = 0);
+
+        /**
+         * Loads the records of a capture file, replacing the current ones.
+         *
+         * @param[in]	fileName	Capture file written by MXRequestRecorder
+         * @return		bool		FALSE if the file can't be read
+         */
+        bool	load(QString const& fileName);
+
+        /**
+         * Replaces the records to replay.
+         *
+         * @param[in]	records	Records, in capture order
+         * @return		void
+         */
+        void	setRecords(QList<MXRequestRecord> const& records);
+
+        /**
+         * Get the loaded records
+         *
+         * @param		void
+         * @return		QList	Constant reference to the records
+         */
+        QList<MXRequestRecord> const&	records(void) const;
+
+        /**
+         * Set the replay speed. 1.0 replays with the captured timings,
+         * N replays N times faster, 0 (or less) sends everything as fast as possible.
+         *
+         * @param[in]	qreal	Speed factor
+         * @return		void
+         */
+        void	setSpeed(qreal speed);
+
+        /**
+         * Get the replay speed
+         *
+         * @param		void
+         * @return		qreal	Speed factor
+         */
+        qreal	speed(void) const;
+
+        /**
+         * Get the replay state
+         *
+         * @param		void
+         * @return		bool	TRUE while requests remain to be sent or answered
+         */
+        bool	isRunning(void) const;
+
+        /**
+         * Get the number of requests answered with a successfully parsed response
+         */
+        int		succeeded(void) const;
+
+        /**
+         * Get the number of requests which failed (network or parsing error)
+         */
+        int		failed(void) const;
+
+    public slots:
+        /**
+         * Starts (or restarts) the replay from the first record.
+         */
+        void	start(void);
+
+        /**
+         * Stops sending records. Requests already sent are still awaited,
+         * finished() is emitted right away if there's none.
+         */
+        void	stop(void);
+
+    private slots:
+        /**
+         * Sends every record which is due, then schedules the next one.
+         */
+        void	sendDue(void);
+
+        /**
+         * Called when a replayed request is answered.
+         */
+        void	replyFinished(void);
+
+    signals:
+        /**
+         * Emitted when every record has been sent and answered
+         */
+        void	finished(void);
+};
+
+#endif // MXREQUESTREPLAYER_HPP
@@ -0,0 +1,330 @@
+/**
+ * @file		MXSessionCache.cpp
+ * @brief		MXSessionCache
+ *
+ * @details		Process-wide TLS session tickets, optionally persisted encrypted
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMessageAuthenticationCode>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QtEndian>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+# include <QRandomGenerator>
+#endif
+
+#include "MXSessionCache.hpp"
+
+// Shared cache
+namespace
+{
+    int const	DefaultLifetime = 3600;	// s, when the server gives no hint
+    int const	NonceSize = 16;
+    int const	TagSize = 32;			// SHA-256
+
+    struct Ticket
+    {
+        QByteArray	ticket;
+        qint64		expires;	// ms since epoch
+    };
+
+    struct CacheState
+    {
+        QMutex					mutex;
+        bool					enabled;
+        QHash<QString, Ticket>	tickets;
+        MXSessionCache::Stats	stats;
+
+        CacheState(void) : enabled(true) {}
+    };
+
+    CacheState	&state(void)
+    {
+        static CacheState	instance;
+
+        return (instance);
+    }
+
+    QByteArray	hmac(QByteArray const& key, QByteArray const& data)
+    {
+        return (QMessageAuthenticationCode::hash(data, key, QCryptographicHash::Sha256));
+    }
+
+    QByteArray	randomBytes(int size)
+    {
+        QByteArray	bytes(size, '\0');
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        int	i = -1;
+
+        while (++i < size)
+            bytes[i] = char(QRandomGenerator::system()->bounded(256));
+#else
+        // No system generator before Qt 5.10: the kernel's, or nothing
+        QFile	urandom("/dev/urandom");
+
+        if (!urandom.open(QIODevice::ReadOnly))
+            return (QByteArray());
+        bytes = urandom.read(size);
+        if (bytes.size() != size)
+            return (QByteArray());
+#endif
+        return (bytes);
+    }
+}
+// ---
+
+// Getters / Setters
+void	MXSessionCache::setEnabled(bool enabled)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().enabled = enabled;
+}
+
+bool	MXSessionCache::isEnabled(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().enabled);
+}
+
+int		MXSessionCache::size(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().tickets.size());
+}
+
+void	MXSessionCache::clear(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().tickets.clear();
+}
+
+MXSessionCache::Stats	MXSessionCache::stats(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    return (state().stats);
+}
+
+void	MXSessionCache::resetStats(void)
+{
+    QMutexLocker	lock(&state().mutex);
+
+    state().stats = Stats();
+}
+// ---
+
+// Treatments
+QString	MXSessionCache::keyOf(QUrl const& url)
+{
+    return (url.host().toLower() + ':' + QString::number(url.port(443)));
+}
+
+bool	MXSessionCache::prepare(QNetworkRequest& request)
+{
+#ifdef	QT_NO_SSL
+    Q_UNUSED(request);
+    return (false);
+#else
+    QSslConfiguration	configuration;
+    QByteArray			ticket;
+
+    {
+        QMutexLocker					lock(&state().mutex);
+        QHash<QString, Ticket>::iterator	i;
+
+        if (!state().enabled)
+            return (false);
+        ++state().stats.lookups;
+        i = state().tickets.find(keyOf(request.url()));
+        if (i != state().tickets.end())
+        {
+            if (i->expires > QDateTime::currentMSecsSinceEpoch())
+            {
+                ticket = i->ticket;
+                ++state().stats.hits;
+            }
+            else
+                state().tickets.erase(i);
+        }
+    }
+
+    // Session persistence lets the reply give its ticket back
+    configuration = request.sslConfiguration();
+    configuration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    configuration.setSessionTicket(ticket);
+    request.setSslConfiguration(configuration);
+    return (!ticket.isEmpty());
+#endif
+}
+
+#ifndef	QT_NO_SSL
+void	MXSessionCache::store(QUrl const& url, QSslConfiguration const& configuration)
+{
+    QByteArray		ticket = configuration.sessionTicket();
+    int				lifetime = configuration.sessionTicketLifeTimeHint();
+    QMutexLocker	lock(&state().mutex);
+    Ticket			*entry;
+
+    if (!state().enabled || ticket.isEmpty())
+        return;
+
+    entry = &state().tickets[keyOf(url)];
+    if (entry->ticket == ticket) // Resumed with the cached ticket
+        return;
+    entry->ticket = ticket;
+    entry->expires = QDateTime::currentMSecsSinceEpoch()
+                     + qint64(lifetime > 0 ? lifetime : DefaultLifetime) * 1000;
+    ++state().stats.stores;
+}
+#endif
+
+QByteArray	MXSessionCache::keystream(QByteArray const& key, QByteArray const& nonce, int size)
+{
+    QByteArray	stream;
+    uchar		counter[4];
+    quint32		block = 0;
+
+    stream.reserve(size + TagSize);
+    while (stream.size() < size)
+    {
+        qToBigEndian(block++, counter);
+        stream.append(hmac(key, nonce + QByteArray(reinterpret_cast<char*>(counter), 4)));
+    }
+    stream.truncate(size);
+    return (stream);
+}
+
+bool	MXSessionCache::save(QString const& fileName, QByteArray const& key)
+{
+    QByteArray	plain;
+    QDataStream	plainStream(&plain, QIODevice::WriteOnly);
+    QByteArray	nonce;
+    QByteArray	cipher;
+    QByteArray	stream;
+    qint64		now = QDateTime::currentMSecsSinceEpoch();
+    int			i = -1;
+
+    if (key.size() < 16)
+        return (false);
+
+    plainStream.setVersion(QDataStream::Qt_5_0);
+    {
+        QMutexLocker							lock(&state().mutex);
+        QHashIterator<QString, Ticket>			ticket(state().tickets);
+        QList<QPair<QString, Ticket> >			valid;
+
+        while (ticket.hasNext())
+        {
+            ticket.next();
+            if (ticket.value().expires > now)
+                valid.append(qMakePair(ticket.key(), ticket.value()));
+        }
+        plainStream << quint32(valid.size());
+        while (++i < valid.size())
+            plainStream << valid.at(i).first << valid.at(i).second.ticket
+                        << valid.at(i).second.expires;
+    }
+
+    nonce = randomBytes(NonceSize);
+    if (nonce.isEmpty())
+        return (false);
+    stream = keystream(hmac(key, "MXSessionCache encryption"), nonce, plain.size());
+    cipher.resize(plain.size());
+    i = -1;
+    while (++i < plain.size())
+        cipher[i] = char(plain.at(i) ^ stream.at(i));
+
+    QSaveFile	file(fileName);
+    QDataStream	out(&file);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return (false);
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint32(MXSESSIONCACHE_MAGIC) << quint32(MXSESSIONCACHE_VERSION)
+        << nonce << cipher << hmac(hmac(key, "MXSessionCache authentication"), nonce + cipher);
+    return (out.status() == QDataStream::Ok && file.commit());
+}
+
+bool	MXSessionCache::load(QString const& fileName, QByteArray const& key)
+{
+    QFile		file(fileName);
+    QDataStream	in(&file);
+    quint32		magic;
+    quint32		version;
+    QByteArray	nonce;
+    QByteArray	cipher;
+    QByteArray	tag;
+    QByteArray	expected;
+    QByteArray	plain;
+    QByteArray	stream;
+    char		diff = 0;
+    int			i = -1;
+
+    if (key.size() < 16 || !file.open(QIODevice::ReadOnly))
+        return (false);
+    in.setVersion(QDataStream::Qt_5_0);
+    in >> magic >> version >> nonce >> cipher >> tag;
+    if (in.status() != QDataStream::Ok || magic != MXSESSIONCACHE_MAGIC
+        || version != MXSESSIONCACHE_VERSION || nonce.size() != NonceSize
+        || tag.size() != TagSize)
+        return (false);
+
+    // Constant time: the tag mustn't leak through timing
+    expected = hmac(hmac(key, "MXSessionCache authentication"), nonce + cipher);
+    while (++i < TagSize)
+        diff |= char(expected.at(i) ^ tag.at(i));
+    if (diff != 0)
+        return (false);
+
+    stream = keystream(hmac(key, "MXSessionCache encryption"), nonce, cipher.size());
+    plain.resize(cipher.size());
+    i = -1;
+    while (++i < cipher.size())
+        plain[i] = char(cipher.at(i) ^ stream.at(i));
+
+    QDataStream		plainStream(plain);
+    QMutexLocker	lock(&state().mutex);
+    qint64			now = QDateTime::currentMSecsSinceEpoch();
+    quint32			count;
+    QString			host;
+    Ticket			ticket;
+
+    plainStream.setVersion(QDataStream::Qt_5_0);
+    plainStream >> count;
+    while (count-- > 0 && plainStream.status() == QDataStream::Ok)
+    {
+        plainStream >> host >> ticket.ticket >> ticket.expires;
+        if (plainStream.status() == QDataStream::Ok && ticket.expires > now
+            && !state().tickets.contains(host))
+            state().tickets.insert(host, ticket);
+    }
+    return (plainStream.status() == QDataStream::Ok);
+}
+// ---
@@ -0,0 +1,145 @@
+/**
+ * @brief		MXSessionCache
+ *
+ * @details		Process-wide TLS session tickets, optionally persisted encrypted
+ *
+ * @version		1.4
+ * @author		Adnan "Max13" RIHAN <adnan@rihan.fr>
+ * @link		http://rihan.fr/
+ * @copyright	http://creativecommons.org/licenses/by-sa/3.0/	CC-by-sa 3.0
+ *
+ * LICENSE: This source file is subject to the "Attribution-ShareAlike 3.0 Unported"
+ * of the Creative Commons license, that is available through the world-wide-web
+ * at the following URI: http://creativecommons.org/licenses/by-sa/3.0/.
+ * If you did not receive a copy of this Creative Commons License and are unable
+ * to obtain it through the web, please send a note to:
+ * "Creative Commons, 171 Second Street, Suite 300,
+ * San Francisco, California 94105, USA" so we can mail you a copy immediately.
+ */
+
+#ifndef		MXSESSIONCACHE_HPP
+# define	MXSESSIONCACHE_HPP
+
+# include	<QByteArray>
+# include	<QString>
+// QtNetwork
+# include	<QtNetwork/QNetworkRequest>
+# ifndef	QT_NO_SSL
+#	include	<QtNetwork/QSslConfiguration>
+# endif
+// ---
+# include	<QUrl>
+
+# define	MXSESSIONCACHE_MAGIC	0x4d585343 // "MXSC"
+# define	MXSESSIONCACHE_VERSION	1
+
+/**
+ * @class	MXSessionCache
+ * @brief	Keeps the TLS session tickets of every HTTPS host of the process
+ *
+ * MXRequestManager offers the cached ticket of a host with each of its
+ * requests, and stores the ticket given by the server once encrypted, and
+ * again once finished (TLS 1.3 servers send it after the handshake).
+ * Tickets are kept until their lifetime hint (1 hour without hint).
+ *
+ * The cache can be saved to a file and loaded by the next process. The file
+ * is encrypted and authenticated with a key of the caller: the keystream is
+ * HMAC-SHA256(key, nonce | counter) and the tag is an HMAC-SHA256 of the
+ * nonce and the ciphertext, with keys derived from the given one.
+ *
+ * Qt doesn't tell whether a server accepted a ticket: hits count the
+ * handshakes offering one.
+ */
+
+class MXSessionCache
+{
+    public:
+        /**
+        * @struct
+        */
+        struct Stats
+        {
+            quint64	lookups;	// HTTPS requests prepared
+            quint64	hits;		// ... offering a ticket
+            quint64	stores;		// Tickets received
+
+            Stats(void) : lookups(0), hits(0), stores(0) {}
+
+            double	hitRate(void) const { return (lookups ? double(hits) / lookups : 0); }
+        };
+
+        /**
+         * Enable or disable the cache (enabled by default).
+         */
+        static void		setEnabled(bool enabled);
+
+        /**
+         * Get the state of the cache
+         */
+        static bool		isEnabled(void);
+
+        /**
+         * Get the number of cached tickets
+         */
+        static int		size(void);
+
+        /**
+         * Forget every ticket. The statistics are kept.
+         */
+        static void		clear(void);
+
+        /**
+         * Get the hit statistics
+         */
+        static Stats	stats(void);
+
+        /**
+         * Reset the hit statistics
+         */
+        static void		resetStats(void);
+
+        /**
+         * Offers the cached ticket of the request's host, if any.
+         * Called by MXRequestManager for every HTTPS request.
+         *
+         * @param[out]	request	Request to prepare
+         * @return		bool	TRUE if a ticket was set
+         */
+        static bool		prepare(QNetworkRequest& request);
+
+# ifndef	QT_NO_SSL
+        /**
+         * Stores the ticket of an encrypted connection.
+         * Called by MXRequestManager once a reply is encrypted.
+         *
+         * @param[in]	url				URL of the reply
+         * @param[in]	configuration	TLS configuration of the reply
+         * @return		void
+         */
+        static void		store(QUrl const& url, QSslConfiguration const& configuration);
+# endif
+
+        /**
+         * Saves the tickets still valid to an encrypted file (owner only).
+         *
+         * @param[in]	fileName	File to write
+         * @param[in]	key			Secret, at least 16 bytes
+         * @return		bool		FALSE on error, or without a secure random source
+         */
+        static bool		save(QString const& fileName, QByteArray const& key);
+
+        /**
+         * Loads the tickets still valid of a file written by save().
+         *
+         * @param[in]	fileName	File to read
+         * @param[in]	key			Secret given to save()
+         * @return		bool		FALSE if the file can't be read or authenticated
+         */
+        static bool		load(QString const& fileName, QByteArray const& key);
+
+    private:
+        static QString		keyOf(QUrl const& url);
+        static QByteArray	keystream(QByteArray const& key, QByteArray const& nonce, int size);
+};
+
+#endif // MXSESSIONCACHE_HPP
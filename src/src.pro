@@ -18,10 +18,35 @@ TARGET		= MXRequestManager2
 TEMPLATE	= lib
 CONFIG		+= staticlib
 
-SOURCES		+= MXRequestManager.cpp
-HEADERS		+= MXRequestManager.hpp
-
-CONFIG(debug, debug|release):  DEFINES += QT_NO_DEBUG_OUTPUT
+SOURCES		+= MXEndpointPool.cpp \
+			   MXJsonPointer.cpp \
+			   MXLatencyHistogram.cpp \
+			   MXMultiPartBody.cpp \
+			   MXOfflineQueue.cpp \
+			   MXProxyFactory.cpp \
+			   MXRequestBatcher.cpp \
+			   MXRequestManager.cpp \
+			   MXRequestMetrics.cpp \
+			   MXRequestRecorder.cpp \
+			   MXRequestReplayer.cpp \
+			   MXSessionCache.cpp
+HEADERS		+= MXEndpointPool.hpp \
+			   MXJsonPointer.hpp \
+			   MXLatencyHistogram.hpp \
+			   MXMultiPartBody.hpp \
+			   MXOfflineQueue.hpp \
+			   MXProxyFactory.hpp \
+			   MXRequestBatcher.hpp \
+			   MXRequestManager.hpp \
+			   MXRequestMetrics.hpp \
+			   MXRequestRecorder.hpp \
+			   MXRequestReplayer.hpp \
+			   MXSessionCache.hpp
+
+# Coverage for the libFuzzer targets (see fuzz/fuzz.pro)
+fuzz {
+	QMAKE_CXXFLAGS	+= -fsanitize=fuzzer-no-link,address,undefined
+}
 
 INSTALLS	+= targethead
 INSTALLS	+= target
@@ -14,5 +14,7 @@ CONFIG      -=  app_bundle
 TEMPLATE    =   app
 LIBS        +=  -L$$shadowed(../src) -lMXRequestManager2
 
-SOURCES     +=  tst_MXRequestManager.cpp
+SOURCES     +=  tst_MXRequestManager.cpp \
+                ../loadgen/MXLoadGenerator.cpp
+HEADERS     +=  ../loadgen/MXLoadGenerator.hpp
 DEFINES     +=  SRCDIR=\\\"$$PWD/\\\"
@@ -1,9 +1,106 @@
+#include <QElapsedTimer>
 #include <QEventLoop>
+#include <QFutureWatcher>
+#include <QNetworkCookieJar>
 #include <QSignalSpy>
 #include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
 #include <QtTest>
 
+#include "../src/MXEndpointPool.hpp"
+#include "../src/MXJsonPointer.hpp"
+#include "../src/MXLatencyHistogram.hpp"
+#include "../src/MXMultiPartBody.hpp"
+#include "../src/MXOfflineQueue.hpp"
+#include "../src/MXProxyFactory.hpp"
+#include "../src/MXRequestBatcher.hpp"
 #include "../src/MXRequestManager.hpp"
+#include "../src/MXRequestMetrics.hpp"
+#include "../src/MXRequestRecorder.hpp"
+#include "../src/MXRequestReplayer.hpp"
+#include "../src/MXSessionCache.hpp"
+#include "../loadgen/MXLoadGenerator.hpp"
+
+struct MXTestEvent
+{
+    Q_GADGET
+    Q_PROPERTY(QString name MEMBER name)
+    Q_PROPERTY(int count MEMBER count)
+
+    public:
+        QString name;
+        int     count;
+};
+
+/**
+ * Local HTTP server answering every request with the same JSON body,
+ * after a delay. Stands in for one replica of the API.
+ */
+class MXStandInServer : public QTcpServer
+{
+    public:
+        int         hits;
+        QByteArray  received;   // Every request, bodies included
+
+        MXStandInServer(QByteArray const& body, int delay) : hits(0)
+        {
+            this->listen(QHostAddress::LocalHost);
+            connect(this, &QTcpServer::newConnection, [this, body, delay]() {
+                QTcpSocket  *socket;
+
+                while ((socket = this->nextPendingConnection()) != NULL)
+                {
+                    QSharedPointer<QByteArray>  request(new QByteArray);
+
+                    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                    connect(socket, &QTcpSocket::readyRead, socket,
+                            [this, socket, request, body, delay]() {
+                        QByteArray  chunk = socket->readAll();
+
+                        this->received.append(chunk);
+                        request->append(chunk);
+                        if (!request->contains("\r\n\r\n"))
+                            return;
+                        request->clear();
+                        ++this->hits;
+                        QTimer::singleShot(delay, socket, [socket, body]() {
+                            socket->write("HTTP/1.1 200 OK\r\n"
+                                          "Content-Type: application/json\r\n"
+                                          "Connection: close\r\n"
+                                          "Content-Length: " + QByteArray::number(body.size())
+                                          + "\r\n\r\n" + body);
+                            socket->disconnectFromHost();
+                        });
+                    });
+                }
+            });
+        }
+
+        QUrl    url(void) const
+        {
+            return (QUrl("http://127.0.0.1:" + QString::number(this->serverPort())));
+        }
+};
+
+/**
+ * Cookie jar counting the lookups made while sending requests
+ */
+class MXCountingCookieJar : public QNetworkCookieJar
+{
+    public:
+        mutable int lookups;
+
+        MXCountingCookieJar(void) : lookups(0) {}
+
+        QList<QNetworkCookie>   cookiesForUrl(QUrl const& url) const override
+        {
+            ++this->lookups;
+            return (QNetworkCookieJar::cookiesForUrl(url));
+        }
+};
 
 class MXRequestManagerTest : public QObject
 {
@@ -20,8 +117,27 @@ class MXRequestManagerTest : public QObject
         void initTestCase();
         void cleanupTestCase();
         void testInternalVariables();
+        void testSharedCopies();
+        void testHeaders();
+        void testProgressInterval();
+        void testProxyFactory();
+        void testTransportSettings();
+        void testSessionCache();
+        void testMultiPartBody();
+        void testJsonBody();
+        void testJsonPointer();
         void testAPIWithParseError();
         void testAPIParsingOK();
+        void testAPIFuture();
+        void testBatcher();
+        void testMetrics();
+        void testEndpointPool();
+        void testHedgedRequest();
+        void testDeadlines();
+        void testOfflineQueue();
+        void testRecordAndReplay();
+        void testLoadGenerator();
+        void testLatencyHistogram();
 };
 
 MXRequestManagerTest::MXRequestManagerTest()
@@ -54,6 +170,296 @@ void MXRequestManagerTest::testInternalVariables()
     QCOMPARE(req.userAgent(), QString("HELLO WORLD UA"));
 }
 
+void MXRequestManagerTest::testSharedCopies()
+{
+    MXRequestManager    req(QUrl(this->m_baseUrl), "Username", "Password");
+    MXRequestManager    copy(req);
+
+    QCOMPARE(copy.transport(), req.transport());
+    QCOMPARE(copy.apiUrl(), req.apiUrl());
+    QCOMPARE(copy.authUser(), QString("Username"));
+
+    copy.setApiUrl(QUrl("http://localhost"));
+    QCOMPARE(req.apiUrl(), QUrl(this->m_baseUrl));
+    QCOMPARE(copy.transport(), req.transport());
+
+    MXRequestManager    moved(std::move(copy));
+
+    QCOMPARE(moved.apiUrl(), QUrl("http://localhost"));
+    QCOMPARE(moved.transport(), req.transport());
+}
+
+void MXRequestManagerTest::testHeaders()
+{
+    MXRequestManager    req(this->m_baseUrl);
+    MXRequestManager    copy(req);
+
+    req.setDefaultHeader("Accept", "application/json");
+    QCOMPARE(req.defaultHeaders().value("Accept"), QByteArray("application/json"));
+    QVERIFY(!copy.defaultHeaders().contains("Accept"));
+    QCOMPARE(copy.userAgent(), req.userAgent());
+
+    req.setRequestHeader("X-Trace-Id", "42");
+    QVERIFY(req.request(this->m_jsonRessource, "POST", QByteArray("{}")));
+    QCOMPARE(req.networkRequest().rawHeader("X-Trace-Id"), QByteArray("42"));
+    QCOMPARE(req.networkRequest().rawHeader("Accept"), QByteArray("application/json"));
+
+    QVERIFY(req.request(this->m_jsonRessource, "GET"));
+    QVERIFY(!req.networkRequest().hasRawHeader("X-Trace-Id"));
+    QVERIFY(req.networkRequest().header(QNetworkRequest::ContentTypeHeader).isNull());
+
+    req.setDefaultHeader("Accept", QByteArray());
+    QVERIFY(!req.defaultHeaders().contains("Accept"));
+
+    // What was set for a request that couldn't be sent doesn't apply to the next one
+    MXStandInServer                     server("{}", 100);
+    MXRequestManager                    local(server.url());
+    QFuture<MXRequestManager::Response> future;
+
+    local.setRequestHeader("X-Trace-Id", "43");
+    local.setRequestTimeout(1);
+    QVERIFY(!local.request(QString(), "POST", QByteArray("{}")));
+    local.setRequestHeader("X-Trace-Id", "44");
+    QVERIFY(!local.request(QString(), "POST", QJsonObject()));
+    future = local.requestAsync("/", "GET");
+    QVERIFY(!local.networkRequest().hasRawHeader("X-Trace-Id"));
+    QVERIFY(local.networkRequest().header(QNetworkRequest::ContentTypeHeader).isNull());
+    QTRY_VERIFY(future.isFinished());
+    QCOMPARE(future.result().interruption, MXRequestManager::NotInterrupted);
+    QCOMPARE(future.result().httpCode, 200);
+}
+
+void MXRequestManagerTest::testProgressInterval()
+{
+    MXRequestManager    req(this->m_baseUrl);
+    QSignalSpy          progressSpy(&req, SIGNAL(downloadProgress(qint64,qint64)));
+    QSignalSpy          totalSpy(&req, SIGNAL(totalDownloadProgress(qint64,qint64)));
+
+    QCOMPARE(req.progressInterval(), 0);
+    req.requestDownloadProgress(1, 10);
+    req.requestDownloadProgress(2, 10);
+    QCOMPARE(progressSpy.count(), 2);
+
+    progressSpy.clear();
+    totalSpy.clear();
+    req.setProgressInterval(60000);
+    req.requestDownloadProgress(1, 10);
+    req.requestDownloadProgress(2, 10);
+    req.requestDownloadProgress(3, 10);
+    req.requestDownloadProgress(10, 10); // Last one: always delivered
+    QCOMPARE(progressSpy.count(), 2);
+    QCOMPARE(progressSpy.last().at(0).toLongLong(), Q_INT64_C(10));
+    QCOMPARE(totalSpy.count(), 2);
+    QCOMPARE(totalSpy.last().at(1).toLongLong(), Q_INT64_C(10));
+
+    // Unknown size: what was coalesced is delivered once the interval elapsed
+    progressSpy.clear();
+    req.setProgressInterval(50);
+    QTest::qWait(60);
+    req.requestDownloadProgress(1, -1);
+    req.requestDownloadProgress(2, -1);
+    req.requestDownloadProgress(3, -1);
+    QCOMPARE(progressSpy.count(), 1);
+    QTRY_COMPARE(progressSpy.count(), 2);
+    QCOMPARE(progressSpy.last().at(0).toLongLong(), Q_INT64_C(3));
+    QTest::qWait(100);
+    QCOMPARE(progressSpy.count(), 2);
+}
+
+void MXRequestManagerTest::testProxyFactory()
+{
+    MXProxyFactory      factory;
+    QNetworkProxy       proxy(QNetworkProxy::HttpProxy, "proxy.local", 3128);
+    QNetworkProxyQuery  query(QUrl("http://example.com/"));
+    QNetworkProxy       previous(QNetworkProxy::applicationProxy());
+
+    MXProxyFactory::setExplicitProxy(proxy);
+    MXProxyFactory::setNoProxy(QStringList() << "localhost" << ".internal");
+    QCOMPARE(MXProxyFactory::cacheSize(), 0);
+
+    QCOMPARE(factory.queryProxy(query).first(), proxy);
+    QCOMPARE(MXProxyFactory::cacheSize(), 1);
+    QCOMPARE(factory.queryProxy(query).first(), proxy);
+    QCOMPARE(MXProxyFactory::cacheSize(), 1);
+
+    QCOMPARE(factory.queryProxy(QNetworkProxyQuery(QUrl("http://LOCALHOST:8080/")))
+             .first().type(), QNetworkProxy::NoProxy);
+    QCOMPARE(factory.queryProxy(QNetworkProxyQuery(QUrl("https://api.internal/")))
+             .first().type(), QNetworkProxy::NoProxy);
+    QCOMPARE(factory.queryProxy(QNetworkProxyQuery(QUrl("https://internal.example.com/")))
+             .first(), proxy);
+
+    MXProxyFactory::setApplicationProxy();
+    MXProxyFactory::setNoProxy(QStringList());
+    QCOMPARE(MXProxyFactory::cacheSize(), 0);
+    QCOMPARE(MXProxyFactory::mode(), MXProxyFactory::ApplicationProxy);
+
+    // The application proxy may change at any time: never cached
+    QNetworkProxy::setApplicationProxy(proxy);
+    QCOMPARE(factory.queryProxy(query).first(), proxy);
+    QNetworkProxy::setApplicationProxy(QNetworkProxy(QNetworkProxy::NoProxy));
+    QCOMPARE(factory.queryProxy(query).first().type(), QNetworkProxy::NoProxy);
+    QCOMPARE(MXProxyFactory::cacheSize(), 0);
+    QNetworkProxy::setApplicationProxy(previous);
+
+    MXRequestManager    req(this->m_baseUrl);
+
+    QVERIFY(req.transport()->proxyFactory() != 0);
+}
+
+void MXRequestManagerTest::testTransportSettings()
+{
+    // Every request goes through the proxy, whatever its host
+    MXStandInServer         proxy("{}", 0);
+    MXRequestManager        req(QUrl("http://mx-proxied.invalid"));
+    MXRequestManager        copy(req);
+    MXCountingCookieJar     *jar = new MXCountingCookieJar;
+    QSignalSpy              finished(&req, SIGNAL(finished(QNetworkReply*)));
+
+    req.setProxy(QNetworkProxy(QNetworkProxy::HttpProxy, "127.0.0.1", proxy.serverPort()));
+    req.setCookieJar(jar);
+    QCOMPARE(req.transport()->cookieJar(), static_cast<QNetworkCookieJar*>(jar));
+    QCOMPARE(copy.cookieJar(), static_cast<QNetworkCookieJar*>(jar));
+    QCOMPARE(copy.proxy().port(), proxy.serverPort());
+
+    QVERIFY(req.request("/", "GET"));
+    QTRY_COMPARE(finished.size(), 1);
+    QCOMPARE(proxy.hits, 1);
+    QVERIFY(jar->lookups > 0);
+    QCOMPARE(req.lastHttpCode(), 200);
+}
+
+void MXRequestManagerTest::testSessionCache()
+{
+#ifdef QT_NO_SSL
+    QSKIP("Built without SSL support");
+#else
+    QTemporaryDir       dir;
+    QString             fileName(dir.path() + "/sessions.mxsc");
+    QByteArray          key("0123456789abcdef0123456789abcdef");
+    QSslConfiguration   configuration;
+    QNetworkRequest     request(QUrl("https://api.example.com/users"));
+    QFile               file(fileName);
+
+    MXSessionCache::clear();
+    MXSessionCache::resetStats();
+    QVERIFY(!MXSessionCache::prepare(request));
+
+    configuration.setSessionTicket("ticket-1");
+    MXSessionCache::store(QUrl("https://API.example.com:443/other"), configuration);
+    QCOMPARE(MXSessionCache::size(), 1);
+    QVERIFY(MXSessionCache::prepare(request));
+    QCOMPARE(request.sslConfiguration().sessionTicket(), QByteArray("ticket-1"));
+    QCOMPARE(MXSessionCache::stats().lookups, quint64(2));
+    QCOMPARE(MXSessionCache::stats().hits, quint64(1));
+    QCOMPARE(MXSessionCache::stats().hitRate(), 0.5);
+
+    QVERIFY(MXSessionCache::save(fileName, key));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(!file.readAll().contains("ticket-1"));
+    QVERIFY(file.permissions() & QFileDevice::ReadOwner);
+    QVERIFY(!(file.permissions() & QFileDevice::ReadOther));
+    file.close();
+
+    MXSessionCache::clear();
+    QVERIFY(!MXSessionCache::load(fileName, "not the right key at all"));
+    QCOMPARE(MXSessionCache::size(), 0);
+    QVERIFY(MXSessionCache::load(fileName, key));
+    QCOMPARE(MXSessionCache::size(), 1);
+    QVERIFY(MXSessionCache::prepare(request));
+    MXSessionCache::clear();
+#endif
+}
+
+void MXRequestManagerTest::testMultiPartBody()
+{
+    QTemporaryDir       dir;
+    QFile               file(dir.path() + "/upload.bin");
+    QByteArray          content(100000, 'x');
+    MXMultiPartBody     body;
+    QSignalSpy          progressSpy(&body, SIGNAL(partProgress(int,qint64,qint64)));
+    QByteArray          boundary;
+    QByteArray          expected;
+
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(content), qint64(content.size()));
+    file.close();
+
+    QCOMPARE(body.addField("title", "Hello \"World\""), 0);
+    QCOMPARE(body.addFile("file", file.fileName(), "text/plain"), 1);
+    QCOMPARE(body.addFile("missing", dir.path() + "/missing.bin"), -1);
+    QVERIFY(body.contentType().startsWith("multipart/form-data; boundary="));
+
+    boundary = body.contentType().mid(body.contentType().indexOf('=') + 1);
+    expected = "--" + boundary + "\r\n"
+               "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+               "Hello \"World\"\r\n"
+               "--" + boundary + "\r\n"
+               "Content-Disposition: form-data; name=\"file\"; filename=\"upload.bin\"\r\n"
+               "Content-Type: text/plain\r\n\r\n"
+               + content + "\r\n"
+               "--" + boundary + "--\r\n";
+
+    QCOMPARE(body.size(), qint64(expected.size()));
+    QVERIFY(body.open(QIODevice::ReadOnly));
+    QCOMPARE(body.read(10), expected.left(10));
+    QCOMPARE(body.readAll(), expected.mid(10));
+    QVERIFY(progressSpy.count() >= 2);
+    QCOMPARE(progressSpy.last().at(0).toInt(), 1);
+    QCOMPARE(progressSpy.last().at(1).toLongLong(), qint64(content.size()));
+
+    QVERIFY(body.seek(0));
+    QCOMPARE(body.readAll(), expected);
+}
+
+void MXRequestManagerTest::testJsonBody()
+{
+    MXRequestManager    req(this->m_baseUrl);
+    MXTestEvent         event;
+    QJsonObject         object;
+
+    object.insert("id", 4);
+    object.insert("username", QString("foo"));
+    QCOMPARE(MXRequestManager::toJsonBody(object), QByteArray("{\"id\":4,\"username\":\"foo\"}"));
+    QCOMPARE(MXRequestManager::toJsonBody(QJsonValue(42)), QByteArray("42"));
+    QCOMPARE(MXRequestManager::toJsonBody(QJsonValue(QString("bar"))), QByteArray("\"bar\""));
+
+    event.name = "click";
+    event.count = 3;
+    QCOMPARE(MXRequestManager::toJsonObject(MXTestEvent::staticMetaObject, &event).value("count")
+             .toInt(), 3);
+
+    QVERIFY(req.request(this->m_jsonRessource, "POST", object));
+    QCOMPARE(req.networkRequest().rawHeader("Content-Type"), QByteArray("application/json"));
+    QVERIFY(req.request(this->m_jsonRessource, "POST", event));
+    QCOMPARE(req.networkRequest().rawHeader("Content-Type"), QByteArray("application/json"));
+}
+
+void MXRequestManagerTest::testJsonPointer()
+{
+    QByteArray  json(" {\"skip\": {\"x\": [1, \"}]\\\"\", {\"y\": null}]},"
+                     "  \"a/b\": {\"m~n\": [10, 20, {\"id\": \"x\\\"y\"}]},"
+                     "  \"esc\\u0061ped\": true, \"\": 0 } ");
+    bool        found;
+
+    QCOMPARE(MXJsonPointer("/a~1b/m~0n/1").value(json), QVariant(20));
+    QCOMPARE(MXJsonPointer("/a~1b/m~0n/2/id").value(json), QVariant(QString("x\"y")));
+    QCOMPARE(MXJsonPointer("/a~1b/m~0n/2").raw(json), QByteArray("{\"id\": \"x\\\"y\"}"));
+    QCOMPARE(MXJsonPointer("/escaped").value(json), QVariant(true));
+    QCOMPARE(MXJsonPointer("/").value(json), QVariant(0));
+    QCOMPARE(MXJsonPointer("").value(json).toMap().size(), 4);
+
+    MXJsonPointer("/skip/x/2/y").value(json, &found);
+    QVERIFY(found);
+    MXJsonPointer("/a~1b/m~0n/3").value(json, &found);
+    QVERIFY(!found);
+    MXJsonPointer("/a~1b/m~0n/01").value(json, &found);
+    QVERIFY(!found);
+    MXJsonPointer("/missing").value(json, &found);
+    QVERIFY(!found);
+    QVERIFY(!MXJsonPointer("no-slash").isValid());
+}
+
 void MXRequestManagerTest::testAPIWithParseError()
 {
     MXRequestManager    req(this->m_baseUrl);
@@ -87,6 +493,549 @@ void MXRequestManagerTest::testAPIParsingOK()
     QVERIFY(!req.data().isEmpty());
     QCOMPARE(req.data().value("self").toMap().value("HEADERS").toMap().value("User-Agent").toString(),
              req.userAgent());
+    QCOMPARE(req.rawValue("/self/HEADERS/User-Agent").toString(), req.userAgent());
+}
+
+void MXRequestManagerTest::testAPIFuture()
+{
+    MXRequestManager                            req(this->m_baseUrl);
+    QEventLoop                                  eventLoop(this);
+    QFutureWatcher<MXRequestManager::Response>  watcher;
+
+    connect(&watcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+
+    watcher.setFuture(req.requestAsync(this->m_jsonRessource, "GET"));
+    eventLoop.exec();
+    QVERIFY(watcher.isFinished());
+    QVERIFY(watcher.result().ok);
+    QCOMPARE(watcher.result().httpCode, 200);
+    QCOMPARE(watcher.result().data.value("self").toMap().value("HEADERS").toMap()
+             .value("User-Agent").toString(), req.userAgent());
+
+    QVERIFY(req.requestAsync(QString(), "GET", QByteArray()).isFinished());
+    QVERIFY(!req.requestAsync(QString(), "GET", QByteArray()).result().ok);
+}
+
+void MXRequestManagerTest::testBatcher()
+{
+    MXRequestManager                            req(this->m_baseUrl);
+    MXRequestBatcher                            batcher(&req, this->m_jsonRessource);
+    QEventLoop                                  eventLoop(this);
+    QFutureWatcher<MXRequestManager::Response>  watcher;
+    MXRequestManager::MXMap                     item;
+
+    connect(&watcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+    batcher.setThresholds(2, 0, 60000);
+
+    item.insert("name", "first");
+    QFuture<MXRequestManager::Response> first = batcher.enqueue(item);
+    QCOMPARE(batcher.pending(), 1);
+    QVERIFY(!first.isFinished());
+
+    item.insert("name", "second");
+    QFuture<MXRequestManager::Response> second = batcher.enqueue(item);
+    QCOMPARE(batcher.pending(), 0); // maxCount reached: flushed
+
+    watcher.setFuture(second);
+    eventLoop.exec();
+    QVERIFY(first.isFinished());
+    // The server doesn't answer with one element per item: both get the bulk response
+    QCOMPARE(first.result().httpCode, second.result().httpCode);
+    QCOMPARE(first.result().rawData, second.result().rawData);
+
+    batcher.setThresholds(0, 0, 10);
+    watcher.setFuture(batcher.enqueue(QJsonObject()));
+    QCOMPARE(batcher.pending(), 1);
+    eventLoop.exec();
+    QCOMPARE(batcher.pending(), 0);
+    QVERIFY(watcher.isFinished());
+
+    // Destroyed with an item buffered and another one in flight
+    MXRequestBatcher                    *doomed = new MXRequestBatcher(&req, this->m_jsonRessource);
+    QFuture<MXRequestManager::Response> sent;
+    QFuture<MXRequestManager::Response> buffered;
+
+    doomed->setThresholds(0, 0, 60000);
+    sent = doomed->enqueue(QJsonObject());
+    doomed->flush();
+    buffered = doomed->enqueue(QJsonObject());
+    QCOMPARE(doomed->pending(), 1);
+    delete doomed;
+    QVERIFY(sent.isFinished());
+    QVERIFY(buffered.isFinished());
+    QCOMPARE(sent.result().interruption, MXRequestManager::Canceled);
+    QCOMPARE(buffered.result().interruption, MXRequestManager::Canceled);
+    QCOMPARE(buffered.result().error, QNetworkReply::OperationCanceledError);
+}
+
+void MXRequestManagerTest::testMetrics()
+{
+    MXRequestManager    req(this->m_baseUrl);
+    MXRequestMetrics    metrics;
+    QEventLoop          eventLoop(this);
+
+    req.setMetrics(&metrics);
+    connect(&req, SIGNAL(finished(bool)), &eventLoop, SLOT(quit()));
+
+    QVERIFY(req.request(this->m_jsonRessource, "GET"));
+    QCOMPARE(metrics.snapshot().inFlight, Q_INT64_C(1));
+    eventLoop.exec();
+    QVERIFY(req.request(this->m_xmlRessource, "POST", QByteArray("abc")));
+    eventLoop.exec();
+
+    MXRequestMetrics::Snapshot  snapshot = metrics.snapshot();
+
+    QCOMPARE(snapshot.inFlight, Q_INT64_C(0));
+    QCOMPARE(snapshot.endpoints.value("GET " + this->m_jsonRessource).requests, quint64(1));
+    QCOMPARE(snapshot.endpoints.value("POST " + this->m_xmlRessource).bytesSent, quint64(3));
+    QVERIFY(snapshot.endpoints.value("GET " + this->m_jsonRessource).bytesReceived > 0);
+    QCOMPARE(snapshot.endpoints.value("GET " + this->m_jsonRessource).latency.count(),
+             quint64(1));
+    QVERIFY(snapshot.httpCodes.value(200) >= 1);
+    QCOMPARE(snapshot.parseFailures, quint64(1)); // XML isn't parsed
+
+    QByteArray  text = metrics.toPrometheus();
+
+    QVERIFY(text.contains("# TYPE mxrequest_duration_seconds histogram\n"));
+    QVERIFY(text.contains("mxrequest_requests_total{endpoint=\"GET /self.json\"} 1\n"));
+    QVERIFY(text.contains("mxrequest_duration_seconds_bucket{endpoint=\"GET /self.json\","
+                          "le=\"+Inf\"} 1\n"));
+    QVERIFY(text.contains("mxrequest_in_flight 0\n"));
+    // On the histogram's boundaries: 1 ms is kept in [992, 1007] us
+    QVERIFY(text.contains("mxrequest_duration_seconds_bucket{endpoint=\"GET /self.json\","
+                          "le=\"0.001007\"}"));
+
+    metrics.reset();
+    QVERIFY(metrics.snapshot().endpoints.isEmpty());
+
+    // Ids in the path don't make one endpoint per resource
+    MXStandInServer     server("{}", 0);
+    MXRequestManager    local(server.url());
+
+    local.setMetrics(&metrics);
+    connect(&local, SIGNAL(finished(bool)), &eventLoop, SLOT(quit()));
+    QVERIFY(local.request("/users/42/files/123e4567-e89b-12d3-a456-426614174000", "GET"));
+    eventLoop.exec();
+    QVERIFY(local.request("/users/43/files/v2", "GET"));
+    eventLoop.exec();
+    snapshot = metrics.snapshot();
+    QCOMPARE(snapshot.endpoints.value("GET /users/:id/files/:uuid").requests, quint64(1));
+    QCOMPARE(snapshot.endpoints.value("GET /users/:id/files/v2").requests, quint64(1));
+}
+
+void MXRequestManagerTest::testEndpointPool()
+{
+    MXEndpointPool  pool(QList<QUrl>() << QUrl("http://a.local/api/")
+                                       << QUrl("https://b.local:8443/v2"));
+    int             first = pool.pick();
+    int             second = pool.pick();
+
+    QVERIFY(first != second); // Least outstanding
+    QCOMPARE(pool.outstanding(first), 1);
+    pool.release(first, 1000, true);
+    pool.release(second, 1000, true);
+    QCOMPARE(pool.outstanding(first), 0);
+    QCOMPARE(pool.samples(), quint64(2));
+
+    pool.setEjection(2, 60000);
+    pool.release(0, 10, false);
+    QVERIFY(pool.isHealthy(0));
+    pool.release(0, 10, false);
+    QVERIFY(!pool.isHealthy(0));
+    QCOMPARE(pool.pick(), 1);
+    QCOMPARE(pool.pick(), 1);
+    QCOMPARE(pool.pick(1), 0); // Ejected, but the only other one
+
+    pool.setStrategy(MXEndpointPool::Ewma);
+    pool.setEjection(0, 0);
+    pool.release(0, 100, true);
+    pool.release(1, 100000, true);
+    QCOMPARE(pool.pick(), 0);
+
+    // Failing fast doesn't look fast, and a readmitted endpoint starts over
+    MXEndpointPool  flaky(QList<QUrl>() << QUrl("http://a.local/") << QUrl("http://b.local/"),
+                          MXEndpointPool::Ewma);
+
+    flaky.release(0, 1000, true);
+    QCOMPARE(flaky.pick(), 1); // Not sampled yet
+    flaky.release(1, 5000, true);
+    QCOMPARE(flaky.pick(), 0);
+    flaky.release(0, 10, false);
+    QVERIFY(flaky.ewma(0) > flaky.ewma(1));
+    QCOMPARE(flaky.pick(), 1);
+    flaky.release(1, 5000, true);
+
+    flaky.setEjection(2, 50);
+    flaky.release(0, 10, false);
+    QVERIFY(!flaky.isHealthy(0));
+    QTest::qWait(60);
+    QCOMPARE(flaky.outstanding(0), 0);
+    flaky.release(flaky.pick(), 5000, true); // Readmits 0
+    flaky.release(0, 10, false);
+    QVERIFY(flaky.isHealthy(0));
+
+    QCOMPARE(pool.rebase(QUrl("http://a.local/api/users?page=2"), 0, 1),
+             QUrl("https://b.local:8443/v2/users?page=2"));
+
+    MXRequestManager    req(this->m_baseUrl);
+
+    QVERIFY(req.endpointPool() == NULL);
+    req.setApiUrls(QList<QUrl>() << QUrl(this->m_baseUrl) << QUrl(this->m_baseUrl + "/"));
+    QVERIFY(req.endpointPool() != NULL);
+    QCOMPARE(req.apiUrl(), QUrl(this->m_baseUrl));
+    QCOMPARE(req.apiUrls().size(), 2);
+    req.setApiUrl(QUrl(this->m_baseUrl));
+    QVERIFY(req.endpointPool() == NULL);
+}
+
+void MXRequestManagerTest::testHedgedRequest()
+{
+    MXStandInServer     slow("{\"server\":\"slow\"}", 10000);
+    MXStandInServer     fast("{\"server\":\"fast\"}", 0);
+    MXRequestManager    req;
+    QEventLoop          eventLoop(this);
+    QElapsedTimer       timer;
+    QTemporaryDir       dir;
+    MXRequestRecorder   recorder(dir.path() + "/hedged.mxrr");
+    int                 i = -1;
+
+    QVERIFY(slow.isListening() && fast.isListening());
+    QVERIFY(recorder.open());
+    req.setRecorder(&recorder);
+    req.setApiUrls(QList<QUrl>() << slow.url() << fast.url());
+    req.endpointPool()->setStrategy(MXEndpointPool::Ewma);
+    req.setHedgePercentile(95);
+
+    // Both looked fast so far, the slow one a bit more
+    while (++i < 20)
+    {
+        req.endpointPool()->release(0, 1000, true);
+        req.endpointPool()->release(1, 2000, true);
+    }
+
+    QFutureWatcher<MXRequestManager::Response>  watcher;
+
+    connect(&watcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+    QTimer::singleShot(5000, &eventLoop, SLOT(quit()));
+    timer.start();
+    watcher.setFuture(req.requestAsync("/resource", "GET"));
+    QCOMPARE(req.endpointPool()->outstanding(0), 1);
+    eventLoop.exec();
+
+    QVERIFY(watcher.isFinished());
+    QVERIFY(timer.elapsed() < 5000);
+    QVERIFY(watcher.result().ok);
+    QCOMPARE(watcher.result().data.value("server").toString(), QString("fast"));
+    QCOMPARE(fast.hits, 1);
+    QCOMPARE(req.endpointPool()->outstanding(0), 0);
+    QCOMPARE(req.endpointPool()->outstanding(1), 0);
+
+    // Captured once, as answered by the copy
+    recorder.close();
+
+    QList<MXRequestRecord>  records = MXRequestRecorder::readAll(dir.path() + "/hedged.mxrr");
+
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records.first().url.port(), fast.url().port());
+    QCOMPARE(records.first().responseBody, QByteArray("{\"server\":\"fast\"}"));
+}
+
+void MXRequestManagerTest::testDeadlines()
+{
+    MXStandInServer     hung("{}", 10000);
+    MXRequestManager    req(hung.url());
+    MXRequestBatcher    batcher(&req, "/bulk");
+    QElapsedTimer       timer;
+
+    QFutureWatcher<MXRequestManager::Response>  watcher;
+    QEventLoop                                  eventLoop(this);
+    QTimer                                      guard;  // Re-armed before each wait
+
+    QVERIFY(hung.isListening());
+    guard.setSingleShot(true);
+    connect(&watcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+    connect(&guard, SIGNAL(timeout()), &eventLoop, SLOT(quit()));
+
+    // Total timeout, by default
+    req.setTimeout(200);
+    timer.start();
+    watcher.setFuture(req.requestAsync("/resource", "GET"));
+    guard.start(5000);
+    eventLoop.exec();
+    QVERIFY(watcher.isFinished());
+    QVERIFY(timer.elapsed() < 5000);
+    QVERIFY(!watcher.result().ok);
+    QCOMPARE(watcher.result().interruption, MXRequestManager::TimedOut);
+    QCOMPARE(watcher.result().error, QNetworkReply::TimeoutError);
+    QCOMPARE(req.lastInterruption(), MXRequestManager::TimedOut);
+
+    // Idle timeout, for this request only
+    req.setTimeout(0);
+    req.setRequestTimeout(-1, 200);
+    watcher.setFuture(req.requestAsync("/resource", "GET"));
+    guard.start(5000);
+    eventLoop.exec();
+    QVERIFY(watcher.isFinished());
+    QCOMPARE(watcher.result().interruption, MXRequestManager::IdleTimedOut);
+
+    // Cancellation
+    QFuture<MXRequestManager::Response> future = req.requestAsync("/resource", "GET");
+
+    QVERIFY(req.cancel(future));
+    QTRY_VERIFY(future.isFinished());
+    QCOMPARE(future.result().interruption, MXRequestManager::Canceled);
+    QCOMPARE(future.result().error, QNetworkReply::OperationCanceledError);
+    QVERIFY(!req.cancel(future));
+
+    // Batched items share the deadline of their bulk request
+    req.setTimeout(200);
+    batcher.setThresholds(0, 0, 50);
+    watcher.setFuture(batcher.enqueue(MXRequestManager::MXMap()));
+    guard.start(5000);
+    eventLoop.exec();
+    QVERIFY(watcher.isFinished());
+    QCOMPARE(watcher.result().interruption, MXRequestManager::TimedOut);
+
+    // Destroyed with a request in flight
+    MXRequestManager    *doomed = new MXRequestManager(hung.url());
+
+    future = doomed->requestAsync("/resource", "GET");
+    delete doomed;
+    QVERIFY(future.isFinished());
+    QCOMPARE(future.result().interruption, MXRequestManager::Canceled);
+    QCOMPARE(future.result().error, QNetworkReply::OperationCanceledError);
+}
+
+void MXRequestManagerTest::testOfflineQueue()
+{
+    QTemporaryDir       dir;
+    QString             fileName(dir.path() + "/outbox.mxoq");
+    QTcpServer          closed;
+    QList<quint64>      ids;
+    int                 i = -1;
+
+    // Nothing listens there anymore
+    QVERIFY(dir.isValid());
+    QVERIFY(closed.listen(QHostAddress::LocalHost));
+
+    MXRequestManager    req(QUrl("http://127.0.0.1:" + QString::number(closed.serverPort())));
+
+    closed.close();
+    {
+        MXOfflineQueue  queue(&req, fileName);
+
+        QVERIFY(queue.open());
+        QCOMPARE(queue.enqueue("/events", "GET"), quint64(0));
+        while (++i < 3)
+            ids.append(queue.enqueue("/events", "POST", QJsonObject({{"n", i}})));
+        QVERIFY(ids.first() > 0);
+        QCOMPARE(queue.pending(), 3);
+        QTRY_VERIFY(!queue.isOnline());
+    }
+
+    // Picked up by the next session, then flushed in order once reachable
+    MXOfflineQueue  queue(&req, fileName);
+    QSignalSpy      delivered(&queue, SIGNAL(delivered(quint64,int)));
+    QSignalSpy      online(&queue, SIGNAL(onlineChanged(bool)));
+
+    queue.setConcurrency(1);
+    queue.setProbe("/", "HEAD", 50);
+    QVERIFY(queue.open());
+    QCOMPARE(queue.pending(), 3);
+    QTRY_VERIFY(!queue.isOnline());
+
+    MXStandInServer     up("{}", 0);
+
+    QVERIFY(up.isListening());
+    req.setApiUrl(up.url());
+    QTRY_COMPARE(queue.pending(), 0);
+    QVERIFY(queue.isOnline());
+    QCOMPARE(online.size(), 2);
+    QCOMPARE(delivered.size(), 3);
+    i = -1;
+    while (++i < 3)
+        QCOMPARE(delivered.at(i).at(0).toULongLong(), ids.at(i));
+
+    // Only the answered requests go away
+    QVERIFY(queue.enqueue("/events", "PUT") > ids.last());
+    QTRY_COMPARE(queue.pending(), 0);
+    QVERIFY(queue.compact());
+    queue.close();
+    QVERIFY(QFileInfo(fileName).size() < 64);
+    QVERIFY(queue.open());
+    QCOMPARE(queue.pending(), 0);
+
+    // Compacted while a request is being sent
+    MXStandInServer     slow("{}", 200);
+
+    req.setApiUrl(slow.url());
+    ids.clear();
+    ids.append(queue.enqueue("/events", "POST"));
+    ids.append(queue.enqueue("/events", "POST"));
+    QCOMPARE(queue.pending(), 2);
+    QVERIFY(queue.compact());
+    QTRY_COMPARE(queue.pending(), 0);
+    QCOMPARE(delivered.size(), 6);
+    QCOMPARE(delivered.at(4).at(0).toULongLong(), ids.at(0));
+    QCOMPARE(delivered.at(5).at(0).toULongLong(), ids.at(1));
+    QCOMPARE(slow.hits, 2);
+    queue.close();
+    QVERIFY(queue.open());
+    QCOMPARE(queue.pending(), 0);
+
+    // Custom verbs keep their body
+    QVERIFY(queue.enqueue("/events", "PATCH", QByteArray("{\"n\":42}")) > 0);
+    QTRY_COMPARE(queue.pending(), 0);
+    QVERIFY(slow.received.contains("PATCH /events"));
+    QTRY_VERIFY(slow.received.endsWith("{\"n\":42}"));
+
+    // Reopened during an outage, back online until the next failure
+    slow.close();
+    QVERIFY(queue.enqueue("/events", "POST") > 0);
+    QTRY_VERIFY(!queue.isOnline());
+    queue.close();
+    online.clear();
+    QVERIFY(queue.open());
+    QCOMPARE(online.size(), 1);
+    QVERIFY(online.first().first().toBool());
+    QTRY_VERIFY(!queue.isOnline());
+}
+
+void MXRequestManagerTest::testRecordAndReplay()
+{
+    QTemporaryDir       dir;
+    QString             fileName(dir.path() + "/capture.mxrr");
+    MXRequestManager    req(this->m_baseUrl);
+    MXRequestRecorder   recorder(fileName);
+    QEventLoop          eventLoop(this);
+
+    QVERIFY(dir.isValid());
+    QVERIFY(recorder.open());
+    req.setRecorder(&recorder);
+    connect(&req, SIGNAL(finished(bool)), &eventLoop, SLOT(quit()));
+    QVERIFY(req.request(this->m_jsonRessource, "GET"));
+    eventLoop.exec();
+    recorder.close();
+
+    bool                    ok;
+    QList<MXRequestRecord>  records = MXRequestRecorder::readAll(fileName, &ok);
+
+    QVERIFY(ok);
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records.first().method, QString("GET"));
+    QCOMPARE(records.first().url.path(), this->m_jsonRessource);
+    QCOMPARE(records.first().httpCode, 200);
+    QVERIFY(!records.first().responseBody.isEmpty());
+
+    MXRequestManager    target(this->m_baseUrl);
+    MXRequestReplayer   replayer(&target);
+    QEventLoop          replayLoop(this);
+
+    QVERIFY(replayer.load(fileName));
+    replayer.setSpeed(0);
+    connect(&replayer, SIGNAL(finished()), &replayLoop, SLOT(quit()));
+    replayer.start();
+    replayLoop.exec();
+    QCOMPARE(replayer.succeeded(), 1);
+    QCOMPARE(replayer.failed(), 0);
+
+    // Stopped while waiting for a record due in a minute
+    QList<MXRequestRecord>  later;
+    QSignalSpy              stopped(&replayer, SIGNAL(finished()));
+
+    later << records.first() << records.first();
+    later.first().offset = 0;
+    later.last().offset = 60000;
+    replayer.setRecords(later);
+    replayer.setSpeed(1);
+    replayer.start();
+    QTRY_COMPARE(replayer.succeeded(), 1);
+    QVERIFY(replayer.isRunning());
+    replayer.stop();
+    QCOMPARE(stopped.size(), 1);
+    QVERIFY(!replayer.isRunning());
+
+    // A record cut by a crash is dropped, the next session stays readable
+    QFile   capture(fileName);
+
+    QVERIFY(capture.open(QIODevice::Append));
+    capture.write(QByteArray::fromHex("00000100") + "cut");
+    capture.close();
+    QVERIFY(recorder.open());
+    QVERIFY(req.request(this->m_jsonRessource, "GET"));
+    eventLoop.exec();
+    recorder.close();
+    records = MXRequestRecorder::readAll(fileName, &ok);
+    QVERIFY(ok);
+    QCOMPARE(records.size(), 2);
+}
+
+void MXRequestManagerTest::testLoadGenerator()
+{
+    QCOMPARE(MXLoadGenerator::dueBy(0, 50), qint64(1));
+    QCOMPARE(MXLoadGenerator::dueBy(19, 50), qint64(1));
+    QCOMPARE(MXLoadGenerator::dueBy(20, 50), qint64(2));
+    QCOMPARE(MXLoadGenerator::scheduledAt(0, 50), qint64(0));
+    QCOMPARE(MXLoadGenerator::scheduledAt(2, 50), qint64(40000000));
+
+    MXStandInServer         server("{}", 200);
+    MXRequestManager        req(server.url());
+    MXRequestRecord         record;
+    QList<MXRequestRecord>  mix;
+
+    record.method = "GET";
+    record.url = QUrl("/");
+    mix << record;
+
+    // Open loop is unbounded by default: 3 requests scheduled 20 ms apart
+    // are all sent before the first answer
+    MXLoadGenerator unbounded(&req);
+    QSignalSpy      unboundedDone(&unbounded, SIGNAL(finished()));
+
+    unbounded.setMix(mix);
+    unbounded.setQps(50);
+    unbounded.setLimits(0, 3);
+    unbounded.start();
+    QTRY_COMPARE(unbounded.started(), qint64(3));
+    QTRY_COMPARE(unboundedDone.size(), 1);
+    QVERIFY(unbounded.latencies().max() < quint64(400000));
+
+    // One at a time, the 3rd request is sent 400 ms after its slot (40 ms):
+    // the wait counts in its latency
+    MXLoadGenerator capped(&req);
+    QSignalSpy      cappedDone(&capped, SIGNAL(finished()));
+
+    capped.setMix(mix);
+    capped.setQps(50);
+    capped.setConcurrency(1);
+    capped.setLimits(0, 3);
+    capped.start();
+    QTRY_COMPARE(cappedDone.size(), 1);
+    QVERIFY(capped.latencies().max() >= quint64(500000));
+}
+
+void MXRequestManagerTest::testLatencyHistogram()
+{
+    MXLatencyHistogram  histogram;
+    MXLatencyHistogram  other;
+    quint64             i = 0;
+
+    QCOMPARE(histogram.percentile(50), quint64(0));
+    while (++i <= 1000)
+        histogram.record(i * 1000);
+
+    QCOMPARE(histogram.count(), quint64(1000));
+    QCOMPARE(histogram.min(), quint64(1000));
+    QCOMPARE(histogram.max(), quint64(1000000));
+    QVERIFY(qAbs(double(histogram.percentile(50)) - 500000.0) / 500000.0 < 0.04);
+    QVERIFY(qAbs(double(histogram.percentile(99)) - 990000.0) / 990000.0 < 0.04);
+    QCOMPARE(histogram.percentile(100), quint64(1000000));
+
+    other.record(5);
+    histogram.merge(other);
+    QCOMPARE(histogram.count(), quint64(1001));
+    QCOMPARE(histogram.min(), quint64(5));
+    QCOMPARE(histogram.countAtOrBelow(5), quint64(1));
 }
 
 QTEST_GUILESS_MAIN(MXRequestManagerTest)